@@ -3,9 +3,270 @@
  ****************************************************************************/
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
 #include "symbol.h"
 #include "ast.h"
+#include "context.h"
 #include "util.h"
+#include "visit.h"
+
+/****************************************************************************
+ * Definitions
+ ****************************************************************************/
+
+#define AST_LIST_MIN    1   /*< room of a new list, grows 1, 2, 4, ... */
+#define AST_SHARE_SIZE  1024    /*< initial slots of sharing table */
+
+typedef enum {
+    AST_class_exp,
+    AST_class_var,
+    AST_class_type,
+} AST_class;
+
+/**
+ * @brief Fields of a pure node, children are pure too and compared by address.
+ */
+typedef struct AST_key_
+{
+    AST_class   class;
+    int         kind;
+    uintptr_t   a, b, c;
+} AST_key;
+
+typedef struct AST_slot_
+{
+    unsigned    hash;
+    AST_class   class;
+    void *      node;       /*< NULL for empty slot */
+} AST_slot;
+
+/**
+ * @brief Sharing table of a context, open addressing with linear probing.
+ *
+ * Kept at most half full, grown by doubling, old tables are left to the
+ * region. AST_find() remembers the slot a missing node goes to, filled by
+ * AST_keep() right after the node is made.
+ */
+typedef struct AST_state_
+{
+    bool        enable;
+    AST_slot *  table;
+    unsigned    cap;        /*< slots */
+    unsigned    cnt;        /*< pure nodes kept */
+    unsigned    hole;       /*< slot of last node not found */
+    unsigned    hash;       /*< hash of last node not found */
+    long        looks;      /*< pure nodes asked for */
+    long        hits;       /*< given back shared */
+} AST_state;
+
+/****************************************************************************
+ * Private: sharing
+ ****************************************************************************/
+
+/**
+ * @brief State of current context.
+ */
+static inline AST_state *AST_cur(void)
+{
+    TIGER_ctx ctx = TIGER_cur();
+
+    if (__builtin_expect(!ctx->ast, 0))
+        ctx->ast = TIGER_mk_state(sizeof(*ctx->ast));
+
+    return ctx->ast;
+}
+
+/* nodes are made with flags cleared, pure constructors set them. */
+
+static inline AST_exp AST_new_exp(void)
+{
+    AST_exp p = UTL_alloc_as(UTL_tag_ast, sizeof(*p));
+
+    p->pure   = false;
+    p->shared = false;
+    return p;
+}
+
+static inline AST_var AST_new_var(void)
+{
+    AST_var p = UTL_alloc_as(UTL_tag_ast, sizeof(*p));
+
+    p->pure   = false;
+    p->shared = false;
+    return p;
+}
+
+static inline AST_type AST_new_type(void)
+{
+    AST_type p = UTL_alloc_as(UTL_tag_ast, sizeof(*p));
+
+    p->pure   = false;
+    p->shared = false;
+    return p;
+}
+
+static void AST_key_of(AST_class class, void *node, AST_key *k)
+{
+    AST_exp  e = node;
+    AST_var  v = node;
+    AST_type t = node;
+
+    *k = (AST_key){ .class = class };
+    switch (class) {
+        case AST_class_exp:
+            k->kind = e->kind;
+            switch (e->kind) {
+                case AST_kind_exp_var: k->a = (uintptr_t)e->u.var;  break;
+                case AST_kind_exp_int: k->a = (uintptr_t)e->u.int_; break;
+                case AST_kind_exp_str: k->a = (uintptr_t)e->u.str_; break;
+                case AST_kind_exp_op:
+                    k->a = e->u.op.oper;
+                    k->b = (uintptr_t)e->u.op.left;
+                    k->c = (uintptr_t)e->u.op.right;
+                    break;
+                default:
+                    break;
+            }
+            break;
+
+        case AST_class_var:
+            k->kind = v->kind;
+            switch (v->kind) {
+                case AST_kind_var_base:
+                    k->a = (uintptr_t)v->u.base.name;
+                    k->b = (uintptr_t)v->u.base.suffix;
+                    break;
+                case AST_kind_var_index:
+                    k->a = (uintptr_t)v->u.index.exp;
+                    k->b = (uintptr_t)v->u.index.suffix;
+                    break;
+                case AST_kind_var_field:
+                    k->a = (uintptr_t)v->u.field.name;
+                    k->b = (uintptr_t)v->u.field.suffix;
+                    break;
+            }
+            break;
+
+        case AST_class_type:
+            k->kind = t->kind;
+            k->a    = t->kind == AST_kind_type_name ? (uintptr_t)t->u.name
+                                                    : (uintptr_t)t->u.array;
+            break;
+    }
+}
+
+/* strings are equal by text, literals are not interned. */
+static inline bool AST_is_str(const AST_key *k)
+{
+    return k->class == AST_class_exp && k->kind == AST_kind_exp_str;
+}
+
+static unsigned AST_hash(const AST_key *k)
+{
+    uint64_t h = (uint64_t)k->class << 8 | k->kind;
+    const char *s;
+
+    if (AST_is_str(k)) {
+        for (s = (const char *)k->a; *s; s++)
+            h = (h ^ (unsigned char)*s) * 0x100000001b3ull;
+    } else {
+        h = (h ^ k->a) * 0x9e3779b97f4a7c15ull;
+        h = (h ^ h >> 29 ^ k->b) * 0x9e3779b97f4a7c15ull;
+        h = (h ^ h >> 29 ^ k->c) * 0x9e3779b97f4a7c15ull;
+    }
+
+    return h ^ h >> 32;
+}
+
+static bool AST_same(const AST_key *k, const AST_slot *slot)
+{
+    AST_key n;
+
+    if (slot->class != k->class)
+        return false;
+
+    AST_key_of(slot->class, slot->node, &n);
+    if (n.kind != k->kind)
+        return false;
+    if (AST_is_str(k))
+        return !strcmp((const char *)n.a, (const char *)k->a);
+
+    return n.a == k->a && n.b == k->b && n.c == k->c;
+}
+
+static void AST_grow_share(AST_state *g)
+{
+    AST_slot *old = g->table;
+    unsigned  cap = g->cap, i, j;
+
+    g->cap   = cap ? cap * 2 : AST_SHARE_SIZE;
+    g->table = UTL_alloc_as(UTL_tag_ast, g->cap * sizeof(*g->table));
+    memset(g->table, 0, g->cap * sizeof(*g->table));
+
+    for (i = 0; i < cap; i++) {
+        if (!old[i].node)
+            continue;
+
+        for (j = old[i].hash & (g->cap - 1); g->table[j].node;
+             j = (j + 1) & (g->cap - 1));
+        g->table[j] = old[i];
+    }
+}
+
+/**
+ * @brief Find pure node made before with fields of k.
+ *
+ * @return void*    Node, marked shared, NULL if none or not sharing.
+ */
+static void *AST_find(const AST_key *k)
+{
+    AST_state *g = AST_cur();
+    AST_slot  *slot;
+    unsigned   i;
+
+    if (!g->enable)
+        return NULL;
+
+    if (2 * (g->cnt + 1) > g->cap)
+        AST_grow_share(g);
+
+    g->looks++;
+    g->hash = AST_hash(k);
+    for (i = g->hash & (g->cap - 1); (slot = &g->table[i])->node;
+         i = (i + 1) & (g->cap - 1)) {
+        if (slot->hash != g->hash || !AST_same(k, slot))
+            continue;
+
+        g->hits++;
+        switch (k->class) {
+            case AST_class_exp:  ((AST_exp)slot->node)->shared  = true; break;
+            case AST_class_var:  ((AST_var)slot->node)->shared  = true; break;
+            case AST_class_type: ((AST_type)slot->node)->shared = true; break;
+        }
+        return slot->node;
+    }
+
+    g->hole = i;
+    return NULL;
+}
+
+/**
+ * @brief Keep node just made, after AST_find() has not found it.
+ *
+ * @return void*    node.
+ */
+static void *AST_keep(AST_class class, void *node)
+{
+    AST_state *g = AST_cur();
+
+    if (g->enable) {
+        g->table[g->hole] = (AST_slot){ g->hash, class, node };
+        g->cnt++;
+    }
+
+    return node;
+}
 
 /****************************************************************************
  * Public: declaration constructor
@@ -13,7 +274,7 @@
 
 AST_dec AST_mk_dec_var(Apos pos, SYM_symbol name, SYM_symbol type, AST_exp init)
 {
-    AST_dec p = UTL_alloc(sizeof(*p));
+    AST_dec p = UTL_alloc_as(UTL_tag_ast, sizeof(*p));
 
     p->kind         = AST_kind_dec_var;
     p->pos          = pos;
@@ -25,11 +286,12 @@ AST_dec AST_mk_dec_var(Apos pos, SYM_symbol name, SYM_symbol type, AST_exp init)
     return p;
 }
 
-AST_dec AST_mk_dec_type(SYM_symbol name, AST_type type)
+AST_dec AST_mk_dec_type(Apos pos, SYM_symbol name, AST_type type)
 {
-    AST_dec p = UTL_alloc(sizeof(*p));
+    AST_dec p = UTL_alloc_as(UTL_tag_ast, sizeof(*p));
 
     p->kind        = AST_kind_dec_type;
+    p->pos         = pos;
     p->u.type.name = name;
     p->u.type.type = type;
 
@@ -39,9 +301,10 @@ AST_dec AST_mk_dec_type(SYM_symbol name, AST_type type)
 AST_dec AST_mk_dec_func(Apos pos, SYM_symbol name, AST_para_list paras,
                         SYM_symbol ret, AST_exp body)
 {
-    AST_dec p = UTL_alloc(sizeof(*p));
+    AST_dec p = UTL_alloc_as(UTL_tag_ast, sizeof(*p));
 
     p->kind         = AST_kind_dec_func;
+    p->pos          = pos;
     p->u.func.name  = name;
     p->u.func.paras = paras;
     p->u.func.ret   = ret;
@@ -56,50 +319,78 @@ AST_dec AST_mk_dec_func(Apos pos, SYM_symbol name, AST_para_list paras,
 
 AST_exp AST_mk_exp_var(Apos pos, AST_var var)
 {
-    AST_exp p = UTL_alloc(sizeof(*p));
+    AST_key k = { .class = AST_class_exp, .kind = AST_kind_exp_var,
+                  .a = (uintptr_t)var };
+    bool pure = var && var->pure;
+    AST_exp p = pure ? AST_find(&k) : NULL;
 
+    if (p)
+        return p;
+
+    p = AST_new_exp();
     p->kind  = AST_kind_exp_var;
     p->pos   = pos;
     p->u.var = var;
+    p->pure  = pure;
 
-    return p;
+    return pure ? AST_keep(AST_class_exp, p) : p;
 }
 
 AST_exp AST_mk_exp_nil(Apos pos)
 {
-    AST_exp p = UTL_alloc(sizeof(*p));
+    AST_key k = { .class = AST_class_exp, .kind = AST_kind_exp_nil };
+    AST_exp p = AST_find(&k);
 
+    if (p)
+        return p;
+
+    p = AST_new_exp();
     p->kind = AST_kind_exp_nil;
     p->pos  = pos;
+    p->pure = true;
 
-    return p;
+    return AST_keep(AST_class_exp, p);
 }
 
 AST_exp AST_mk_exp_int(Apos pos, int i)
 {
-    AST_exp p = UTL_alloc(sizeof(*p));
+    AST_key k = { .class = AST_class_exp, .kind = AST_kind_exp_int,
+                  .a = (uintptr_t)i };
+    AST_exp p = AST_find(&k);
 
+    if (p)
+        return p;
+
+    p = AST_new_exp();
     p->kind   = AST_kind_exp_int;
     p->pos    = pos;
     p->u.int_ = i;
+    p->pure   = true;
 
-    return p;
+    return AST_keep(AST_class_exp, p);
 }
 
 AST_exp AST_mk_exp_str(Apos pos, const char *s)
 {
-    AST_exp p = UTL_alloc(sizeof(*p));
+    AST_key k = { .class = AST_class_exp, .kind = AST_kind_exp_str,
+                  .a = (uintptr_t)s };
+    AST_exp p = AST_find(&k);
 
+    if (p)
+        return p;
+
+    p = AST_new_exp();
     p->kind   = AST_kind_exp_str;
     p->pos    = pos;
     p->u.str_ = s;
+    p->pure   = true;
 
-    return p;
+    return AST_keep(AST_class_exp, p);
 }
 
 AST_exp AST_mk_exp_call(Apos pos, SYM_symbol func, AST_exp_list args)
 {
-    AST_exp p = UTL_alloc(sizeof(*p));
+    AST_exp p = AST_new_exp();
 
     p->kind        = AST_kind_exp_call;
     p->pos         = pos;
@@ -112,21 +403,29 @@ AST_exp AST_mk_exp_call(Apos pos, SYM_symbol func, AST_exp_list args)
 AST_exp AST_mk_exp_op(Apos pos, AST_kind_op oper,
                       AST_exp left, AST_exp right)
 {
-    AST_exp p = UTL_alloc(sizeof(*p));
+    AST_key k = { .class = AST_class_exp, .kind = AST_kind_exp_op,
+                  .a = oper, .b = (uintptr_t)left, .c = (uintptr_t)right };
+    bool pure = left && left->pure && right && right->pure;
+    AST_exp p = pure ? AST_find(&k) : NULL;
+
+    if (p)
+        return p;
 
+    p = AST_new_exp();
     p->kind       = AST_kind_exp_op;
     p->pos        = pos;
     p->u.op.oper  = oper;
     p->u.op.left  = left;
     p->u.op.right = right;
+    p->pure       = pure;
 
-    return p;
+    return pure ? AST_keep(AST_class_exp, p) : p;
 }
 
 AST_exp AST_mk_exp_array(Apos pos, SYM_symbol type, AST_exp size,
                          AST_exp init)
 {
-    AST_exp p = UTL_alloc(sizeof(*p));
+    AST_exp p = AST_new_exp();
 
     p->kind         = AST_kind_exp_array;
     p->pos          = pos;
@@ -139,7 +438,7 @@ AST_exp AST_mk_exp_array(Apos pos, SYM_symbol type, AST_exp size,
 
 AST_exp AST_mk_exp_record(Apos pos, SYM_symbol type, AST_arg_list args)
 {
-    AST_exp p = UTL_alloc(sizeof(*p));
+    AST_exp p = AST_new_exp();
 
     p->kind          = AST_kind_exp_record;
     p->pos           = pos;
@@ -151,7 +450,7 @@ AST_exp AST_mk_exp_record(Apos pos, SYM_symbol type, AST_arg_list args)
 
 AST_exp AST_mk_exp_seq(Apos pos, AST_exp_list seq)
 {
-    AST_exp p = UTL_alloc(sizeof(*p));
+    AST_exp p = AST_new_exp();
 
     p->kind  = AST_kind_exp_seq;
     p->pos   = pos;
@@ -162,7 +461,7 @@ AST_exp AST_mk_exp_seq(Apos pos, AST_exp_list seq)
 
 AST_exp AST_mk_exp_assign(Apos pos, AST_var var, AST_exp exp)
 {
-    AST_exp p = UTL_alloc(sizeof(*p));
+    AST_exp p = AST_new_exp();
 
     p->kind         = AST_kind_exp_assign;
     p->pos          = pos;
@@ -174,7 +473,7 @@ AST_exp AST_mk_exp_assign(Apos pos, AST_var var, AST_exp exp)
 
 AST_exp AST_mk_exp_if(Apos pos, AST_exp cond, AST_exp then, AST_exp else_)
 {
-    AST_exp p = UTL_alloc(sizeof(*p));
+    AST_exp p = AST_new_exp();
 
     p->kind        = AST_kind_exp_if;
     p->pos         = pos;
@@ -187,7 +486,7 @@ AST_exp AST_mk_exp_if(Apos pos, AST_exp cond, AST_exp then, AST_exp else_)
 
 AST_exp AST_mk_exp_while(Apos pos, AST_exp cond, AST_exp body)
 {
-    AST_exp p = UTL_alloc(sizeof(*p));
+    AST_exp p = AST_new_exp();
 
     p->kind          = AST_kind_exp_while;
     p->pos           = pos;
@@ -200,7 +499,7 @@ AST_exp AST_mk_exp_while(Apos pos, AST_exp cond, AST_exp body)
 AST_exp AST_mk_exp_for(Apos pos, SYM_symbol var, AST_exp lo, AST_exp hi,
                        AST_exp body)
 {
-    AST_exp p = UTL_alloc(sizeof(*p));
+    AST_exp p = AST_new_exp();
 
     p->kind          = AST_kind_exp_for;
     p->pos           = pos;
@@ -215,7 +514,7 @@ AST_exp AST_mk_exp_for(Apos pos, SYM_symbol var, AST_exp lo, AST_exp hi,
 
 AST_exp AST_mk_exp_break(Apos pos)
 {
-    AST_exp p = UTL_alloc(sizeof(*p));
+    AST_exp p = AST_new_exp();
 
     p->kind = AST_kind_exp_break;
     p->pos  = pos;
@@ -225,7 +524,7 @@ AST_exp AST_mk_exp_break(Apos pos)
 
 AST_exp AST_mk_exp_let(Apos pos, AST_dec_list decs, AST_exp_list body)
 {
-    AST_exp p = UTL_alloc(sizeof(*p));
+    AST_exp p = AST_new_exp();
 
     p->kind       = AST_kind_exp_let;
     p->pos        = pos;
@@ -241,38 +540,62 @@ AST_exp AST_mk_exp_let(Apos pos, AST_dec_list decs, AST_exp_list body)
 
 AST_var AST_mk_var_base(Apos pos, SYM_symbol name, AST_var suffix)
 {
-    AST_var p = UTL_alloc(sizeof(*p));
+    AST_key k = { .class = AST_class_var, .kind = AST_kind_var_base,
+                  .a = (uintptr_t)name, .b = (uintptr_t)suffix };
+    bool pure = !suffix || suffix->pure;
+    AST_var p = pure ? AST_find(&k) : NULL;
+
+    if (p)
+        return p;
 
+    p = AST_new_var();
     p->kind          = AST_kind_var_base;
     p->pos           = pos;
     p->u.base.name   = name;
     p->u.base.suffix = suffix;
+    p->pure          = pure;
 
-    return p;
+    return pure ? AST_keep(AST_class_var, p) : p;
 }
 
 AST_var AST_mk_var_index(Apos pos, AST_exp exp, AST_var suffix)
 {
-    AST_var p = UTL_alloc(sizeof(*p));
+    AST_key k = { .class = AST_class_var, .kind = AST_kind_var_index,
+                  .a = (uintptr_t)exp, .b = (uintptr_t)suffix };
+    bool pure = exp && exp->pure && (!suffix || suffix->pure);
+    AST_var p = pure ? AST_find(&k) : NULL;
+
+    if (p)
+        return p;
 
+    p = AST_new_var();
     p->kind           = AST_kind_var_index;
     p->pos            = pos;
     p->u.index.exp    = exp;
     p->u.index.suffix = suffix;
+    p->pure           = pure;
 
-    return p;
+    return pure ? AST_keep(AST_class_var, p) : p;
 }
 
 AST_var AST_mk_var_field(Apos pos, SYM_symbol field, AST_var suffix)
 {
-    AST_var p = UTL_alloc(sizeof(*p));
+    AST_key k = { .class = AST_class_var, .kind = AST_kind_var_field,
+                  .a = (uintptr_t)field, .b = (uintptr_t)suffix };
+    bool pure = !suffix || suffix->pure;
+    AST_var p = pure ? AST_find(&k) : NULL;
+
+    if (p)
+        return p;
 
+    p = AST_new_var();
     p->kind           = AST_kind_var_field;
     p->pos            = pos;
     p->u.field.name   = field;
     p->u.field.suffix = suffix;
+    p->pure           = pure;
 
-    return p;
+    return pure ? AST_keep(AST_class_var, p) : p;
 }
 
 /****************************************************************************
@@ -281,29 +604,43 @@ AST_var AST_mk_var_field(Apos pos, SYM_symbol field, AST_var suffix)
 
 AST_type AST_mk_type_name(Apos pos, SYM_symbol name)
 {
-    AST_type p = UTL_alloc(sizeof(*p));
+    AST_key  k = { .class = AST_class_type, .kind = AST_kind_type_name,
+                   .a = (uintptr_t)name };
+    AST_type p = AST_find(&k);
 
+    if (p)
+        return p;
+
+    p = AST_new_type();
     p->kind     = AST_kind_type_name;
     p->pos      = pos;
     p->u.name   = name;
+    p->pure     = true;
 
-    return p;
+    return AST_keep(AST_class_type, p);
 }
 
 AST_type AST_mk_type_array(Apos pos, SYM_symbol array)
 {
-    AST_type p = UTL_alloc(sizeof(*p));
+    AST_key  k = { .class = AST_class_type, .kind = AST_kind_type_array,
+                   .a = (uintptr_t)array };
+    AST_type p = AST_find(&k);
 
+    if (p)
+        return p;
+
+    p = AST_new_type();
     p->kind     = AST_kind_type_array;
     p->pos      = pos;
     p->u.array  = array;
+    p->pure     = true;
 
-    return p;
+    return AST_keep(AST_class_type, p);
 }
 
 AST_type AST_mk_type_record(Apos pos, AST_para_list fields)
 {
-    AST_type p = UTL_alloc(sizeof(*p));
+    AST_type p = AST_new_type();
 
     p->kind     = AST_kind_type_record;
     p->pos      = pos;
@@ -313,52 +650,100 @@ AST_type AST_mk_type_record(Apos pos, AST_para_list fields)
 }
 
 /****************************************************************************
- * Public: link list constructor
+ * Private: list growth
  ****************************************************************************/
 
-AST_dec_list AST_mk_dec_list(AST_dec head, AST_dec_list tail)
+/**
+ * @brief Move list to a block with room for twice the elements.
+ *
+ * Small blocks go back to their pool, large ones stay in region until it
+ * is released, at most as much as the final block.
+ *
+ * @param[in] list      NULL for a new list.
+ * @param[in] n         Elements to keep.
+ * @param[in,out] cap   Room of list, room of the new block on return.
+ * @param[in] head      Header size.
+ * @param[in] item      Element size.
+ * @return new block, header to be set by caller.
+ */
+static void *AST_grow_list(void *list, int n, int *cap, size_t head,
+                           size_t item)
 {
-    AST_dec_list p = UTL_alloc(sizeof(*p));
+    int more = *cap ? *cap * 2 : AST_LIST_MIN;
+    void *p = UTL_pool_alloc(UTL_tag_ast, head + more * item);
 
-    p->head = head;
-    p->tail = tail;
+    if (list) {
+        memcpy(p, list, head + n * item);
+        UTL_pool_free(UTL_tag_ast, list, head + *cap * item);
+    }
 
+    *cap = more;
     return p;
 }
 
-AST_exp_list AST_mk_exp_list(AST_exp head, AST_exp_list tail)
+/****************************************************************************
+ * Public: list constructor
+ ****************************************************************************/
+
+AST_dec_list AST_push_dec(AST_dec_list list, AST_dec dec)
+{
+    int n = AST_LEN(list), cap = list ? list->cap : 0;
+
+    if (n == cap) {
+        list = AST_grow_list(list, n, &cap, sizeof(*list), sizeof(dec));
+        list->n   = n;
+        list->cap = cap;
+    }
+    list->items[list->n++] = dec;
+
+    return list;
+}
+
+AST_exp_list AST_push_exp(AST_exp_list list, AST_exp exp)
 {
-    AST_exp_list p = UTL_alloc(sizeof(*p));
+    int n = AST_LEN(list), cap = list ? list->cap : 0;
 
-    p->head = head;
-    p->tail = tail;
+    if (n == cap) {
+        list = AST_grow_list(list, n, &cap, sizeof(*list), sizeof(exp));
+        list->n   = n;
+        list->cap = cap;
+    }
+    list->items[list->n++] = exp;
 
-    return p;
+    return list;
 }
 
-AST_para_list AST_mk_para_list(AST_para head, AST_para_list tail)
+AST_para_list AST_push_para(AST_para_list list, AST_para para)
 {
-    AST_para_list p = UTL_alloc(sizeof(*p));
+    int n = AST_LEN(list), cap = list ? list->cap : 0;
 
-    p->head = head;
-    p->tail = tail;
+    if (n == cap) {
+        list = AST_grow_list(list, n, &cap, sizeof(*list), sizeof(para));
+        list->n   = n;
+        list->cap = cap;
+    }
+    list->items[list->n++] = para;
 
-    return p;
+    return list;
 }
 
-AST_arg_list AST_mk_arg_list(AST_arg head, AST_arg_list tail)
+AST_arg_list AST_push_arg(AST_arg_list list, AST_arg arg)
 {
-    AST_arg_list p = UTL_alloc(sizeof(*p));
+    int n = AST_LEN(list), cap = list ? list->cap : 0;
 
-    p->head = head;
-    p->tail = tail;
+    if (n == cap) {
+        list = AST_grow_list(list, n, &cap, sizeof(*list), sizeof(arg));
+        list->n   = n;
+        list->cap = cap;
+    }
+    list->items[list->n++] = arg;
 
-    return p;
+    return list;
 }
 
 AST_para AST_mk_para(Apos pos, SYM_symbol name, SYM_symbol type)
 {
-    AST_para p = UTL_alloc(sizeof(*p));
+    AST_para p = UTL_alloc_as(UTL_tag_ast, sizeof(*p));
 
     p->pos      = pos;
     p->name     = name;
@@ -370,10 +755,66 @@ AST_para AST_mk_para(Apos pos, SYM_symbol name, SYM_symbol type)
 
 AST_arg AST_mk_arg(SYM_symbol name, AST_exp exp)
 {
-    AST_arg p = UTL_alloc(sizeof(*p));
+    AST_arg p = UTL_alloc_as(UTL_tag_ast, sizeof(*p));
 
     p->name = name;
     p->exp  = exp;
 
     return p;
 }
+
+/****************************************************************************
+ * Public: sharing
+ ****************************************************************************/
+
+void AST_share(bool enable)
+{
+    AST_state *g = AST_cur();
+
+    // a table is only good for nodes of the region it was made in.
+    g->enable = enable;
+    g->table  = NULL;
+    g->cap    = 0;
+    g->cnt    = 0;
+    if (enable) {
+        g->looks = 0;
+        g->hits  = 0;
+    }
+}
+
+void AST_report_share(FILE *out)
+{
+    AST_state *g = AST_cur();
+
+    fprintf(out, "shared ast: %ld pure nodes, %ld shared, %.1f%%\n",
+            g->looks, g->hits, g->looks ? 100.0 * g->hits / g->looks : 0.0);
+}
+
+/****************************************************************************
+ * Public: tool function
+ ****************************************************************************/
+
+/* count node on entering it, lists are not nodes. */
+static void AST_count_node(VIS_class class, void *node, int depth, void *ctx)
+{
+    switch (class) {
+        case VIS_exp_list:
+        case VIS_dec_list:
+        case VIS_para_list:
+        case VIS_arg_list:
+            break;
+
+        default:
+            ++*(int *)ctx;
+    }
+}
+
+int AST_count(AST_exp n)
+{
+    int sum = 0;
+
+    if (n)
+        VIS_order(VIS_exp, n, AST_count_node, NULL, &sum);
+
+    return sum;
+}
@@ -5,6 +5,7 @@
  ****************************************************************************/
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include "symbol.h"
@@ -24,7 +25,12 @@ typedef struct AST_arg_list_ *  AST_arg_list;
 typedef struct AST_dec_list_ *  AST_dec_list;
 typedef struct AST_exp_list_ *  AST_exp_list;
 
-typedef int Apos;
+/**
+ * @brief Source position, byte offset into source text.
+ *
+ * Line and column are resolved on demand, see SRC_locate().
+ */
+typedef int32_t Apos;
 
 typedef enum {
     AST_kind_op_plus,
@@ -39,6 +45,15 @@ typedef enum {
     AST_kind_op_ge,
 } AST_kind_op;
 
+/**
+ * @brief Text of AST_dump().
+ */
+typedef enum {
+    AST_dump_tree,      /*< one node part per line, as AST_print() */
+    AST_dump_compact,   /*< s-expression on one line */
+    AST_dump_json,      /*< json on one line */
+} AST_dump_format;
+
 struct AST_dec_
 {
     Apos pos;
@@ -81,7 +96,9 @@ struct AST_exp_
         AST_kind_exp_for,
         AST_kind_exp_break,
         AST_kind_exp_let,
-    } kind;
+    } kind : 8;
+    bool pure : 1;      /*< no side effect, see AST_share() */
+    bool shared : 1;    /*< one node for several parents, see AST_share() */
 
     union {
         AST_var                                                     var;
@@ -110,7 +127,9 @@ struct AST_var_
         AST_kind_var_base,
         AST_kind_var_index,
         AST_kind_var_field,
-    } kind;
+    } kind : 8;
+    bool pure : 1;      /*< no side effect, see AST_share() */
+    bool shared : 1;    /*< one node for several parents, see AST_share() */
 
     union {
         struct { SYM_symbol name; AST_var suffix; } base;
@@ -127,7 +146,9 @@ struct AST_type_
         AST_kind_type_name,
         AST_kind_type_array,
         AST_kind_type_record,
-    } kind;
+    } kind : 8;
+    bool pure : 1;      /*< no side effect, see AST_share() */
+    bool shared : 1;    /*< one node for several parents, see AST_share() */
 
     union {
         SYM_symbol    name;
@@ -137,11 +158,25 @@ struct AST_type_
 };
 
 struct AST_arg_         { SYM_symbol name; AST_exp exp; };
-struct AST_arg_list_    { AST_arg    head; AST_arg_list    tail; };
 struct AST_para_        { SYM_symbol name, type; Apos pos; bool escape; };
-struct AST_para_list_   { AST_para   head; AST_para_list   tail; };
-struct AST_dec_list_    { AST_dec    head; AST_dec_list    tail; };
-struct AST_exp_list_    { AST_exp    head; AST_exp_list    tail; };
+
+/* Lists are a length and the elements right behind it, in one block. NULL
+ * is the empty list. Short lists fit a pool size class, long ones are
+ * moved to a block twice as large when full, see AST_push_exp().
+ *
+ * The block is the small storage, there is no room for elements inside the
+ * parent node: parser actions build a list before its parent exists, and
+ * images keep lists as records of their own.
+ */
+struct AST_arg_list_    { int n, cap; AST_arg   items[]; };
+struct AST_para_list_   { int n, cap; AST_para  items[]; };
+struct AST_dec_list_    { int n, cap; AST_dec   items[]; };
+struct AST_exp_list_    { int n, cap; AST_exp   items[]; };
+
+/**
+ * @brief Elements of any list, 0 for NULL.
+ */
+#define AST_LEN(list) ((list) ? (list)->n : 0)
 
 /****************************************************************************
  * Public: declaration constructor
@@ -163,7 +198,7 @@ AST_dec AST_mk_dec_var(Apos pos, SYM_symbol name, SYM_symbol type, AST_exp init)
  * @param[in] type  type definition astnode.
  * @return new astnode.
  */
-AST_dec AST_mk_dec_type(SYM_symbol name, AST_type type);
+AST_dec AST_mk_dec_type(Apos pos, SYM_symbol name, AST_type type);
 /**
  * make function declare astnode.
  * @param[in] pos
@@ -357,37 +392,37 @@ AST_type AST_mk_type_array(Apos pos, SYM_symbol array);
 AST_type AST_mk_type_record(Apos pos, AST_para_list fields);
 
 /****************************************************************************
- * Public: link list constructor
+ * Public: list constructor
  ****************************************************************************/
 
 /**
- * make declaration link list node.
- * @param[in] head
- * @param[in] tail
- * @return new astnode.
+ * append declaration to list.
+ * @param[in] list  list, NULL for a new one.
+ * @param[in] dec
+ * @return list, moved if it was full.
  */
-AST_dec_list AST_mk_dec_list(AST_dec head, AST_dec_list tail);
+AST_dec_list AST_push_dec(AST_dec_list list, AST_dec dec);
 /**
- * make expression link list node.
- * @param[in] head
- * @param[in] tail
- * @return new astnode.
+ * append expression to list.
+ * @param[in] list  list, NULL for a new one.
+ * @param[in] exp
+ * @return list, moved if it was full.
  */
-AST_exp_list AST_mk_exp_list(AST_exp head, AST_exp_list tail);
+AST_exp_list AST_push_exp(AST_exp_list list, AST_exp exp);
 /**
- * make parameter link list node.
- * @param[in] head
- * @param[in] tail
- * @return new astnode.
+ * append parameter to list.
+ * @param[in] list  list, NULL for a new one.
+ * @param[in] para
+ * @return list, moved if it was full.
  */
-AST_para_list AST_mk_para_list(AST_para head, AST_para_list tail);
+AST_para_list AST_push_para(AST_para_list list, AST_para para);
 /**
- * make argument link list node.
- * @param[in] head
- * @param[in] tail
- * @return new astnode.
+ * append argument to list.
+ * @param[in] list  list, NULL for a new one.
+ * @param[in] arg
+ * @return list, moved if it was full.
  */
-AST_arg_list AST_mk_arg_list(AST_arg head, AST_arg_list tail);
+AST_arg_list AST_push_arg(AST_arg_list list, AST_arg arg);
 /**
  * make parameter astnode.
  * @param[in] pos
@@ -404,6 +439,36 @@ AST_para AST_mk_para(Apos pos, SYM_symbol var, SYM_symbol type);
  */
 AST_arg AST_mk_arg(SYM_symbol var, AST_exp exp);
 
+/****************************************************************************
+ * Public: sharing
+ ****************************************************************************/
+
+/**
+ * @brief Enable or disable hash-consing of pure nodes.
+ *
+ * Literals, lvalues whose indexes are pure, operators on pure operands and
+ * type references are pure. While enabled, making a pure node equal to
+ * one made before gives back that node, marked shared. No pass reads the
+ * mark yet. One that keeps its result per shared node may only do so for
+ * results that do not depend on scope: an lvalue or a type reference
+ * names a different thing under each let, so its type must be found in
+ * every use. A shared node keeps the position it was first made at, so
+ * errors must not be reported from a shared tree. Nodes are never changed
+ * once made, so this holds for every parent.
+ *
+ * Table is kept in current region, disable before the region is released.
+ *
+ * @param[in] enable
+ */
+void AST_share(bool enable);
+
+/**
+ * @brief Show pure nodes made and how many were shared.
+ *
+ * @param[in] out
+ */
+void AST_report_share(FILE *out);
+
 /****************************************************************************
  * Public: tool function
  ****************************************************************************/
@@ -414,3 +479,29 @@ AST_arg AST_mk_arg(SYM_symbol var, AST_exp exp);
  * @param[in] root  root node.
  */
 void AST_print(FILE *out, AST_exp root);
+
+/**
+ * dump abstract syntax tree through a large buffer.
+ * @param[in] out       output file, written in whole buffers.
+ * @param[in] root      root node.
+ * @param[in] format    text to dump.
+ * @return 0 on success, -1 if cannot write.
+ */
+int AST_dump(FILE *out, AST_exp root, AST_dump_format format);
+
+/**
+ * dump abstract syntax tree straight to a file descriptor, no stdio.
+ * @param[in] fd        output, flush any stdio stream on it first.
+ * @param[in] root      root node.
+ * @param[in] format    text to dump.
+ * @return 0 on success, -1 if cannot write.
+ */
+int AST_dump_fd(int fd, AST_exp root, AST_dump_format format);
+
+/**
+ * count nodes of tree, list cells not counted.
+ * @param[in] root  root node.
+ * @return expressions, declarations, variables, types, parameters and
+ *         arguments under root.
+ */
+int AST_count(AST_exp root);
@@ -0,0 +1,84 @@
+/****************************************************************************
+ * Includes
+ ****************************************************************************/
+
+#include <stdlib.h>
+#include "context.h"
+#include "util.h"
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static struct TIGER_ctx_    main_ctx;
+static _Thread_local TIGER_ctx current = &main_ctx;
+static _Thread_local jmp_buf *thread_bail;
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+TIGER_ctx TIGER_mk_ctx(void)
+{
+    return TIGER_mk_state(sizeof(struct TIGER_ctx_));
+}
+
+void TIGER_free_ctx(TIGER_ctx ctx)
+{
+    TIGER_ctx saved = current;
+
+    // release arenas in the context being freed.
+    current = ctx;
+    UTL_free();
+    current = saved == ctx ? &main_ctx : saved;
+
+    free(ctx->utl);
+    free(ctx->sym);
+    free(ctx->ast);
+    free(ctx->lex);
+    free(ctx->smt);
+    free(ctx->tmp);
+    free(ctx->tr);
+
+    if (ctx == &main_ctx)
+        *ctx = (struct TIGER_ctx_){ 0 };
+    else
+        free(ctx);
+}
+
+void TIGER_use(TIGER_ctx ctx)
+{
+    current = ctx ? ctx : &main_ctx;
+}
+
+TIGER_ctx TIGER_cur(void)
+{
+    return current;
+}
+
+void TIGER_bail_thread(jmp_buf *bail)
+{
+    thread_bail = bail;
+}
+
+jmp_buf *TIGER_bail(void)
+{
+    return thread_bail ? thread_bail : current->bail;
+}
+
+FILE *TIGER_out(void)
+{
+    return current->out ? current->out : stdout;
+}
+
+void *TIGER_mk_state(size_t size)
+{
+    void *p = calloc(1, size);
+
+    if (!p) {
+        fprintf(stderr, "run out of memory\n");
+        exit(1);
+    }
+
+    return p;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+/****************************************************************************
+ * Includes
+ ****************************************************************************/
+
+#include <setjmp.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/****************************************************************************
+ * Definitions
+ ****************************************************************************/
+
+/**
+ * @brief Compiler context, state of one compilation.
+ *
+ * Every module keeps its state in the context instead of globals, created
+ * zeroed on first use. Each thread works on its own current context, see
+ * TIGER_use(), so files can be compiled concurrently in one process.
+ */
+typedef struct TIGER_ctx_ *TIGER_ctx;
+
+struct TIGER_ctx_
+{
+    struct UTL_state_ * utl;    /*< regions, pools, statistics */
+    struct SYM_state_ * sym;    /*< interner, environment statistics */
+    struct AST_state_ * ast;    /*< hash-consing table */
+    struct LEX_state_ * lex;    /*< lexer selection and scanning */
+    struct SMT_state_ * smt;    /*< semantic hooks */
+    struct TMP_state_ * tmp;    /*< temp and label counters */
+    struct TR_state_ *  tr;     /*< outermost level */
+
+    FILE *              out;    /*< messages, stdout if NULL */
+    jmp_buf *           bail;   /*< UTL_error() jumps here, exits if NULL */
+};
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/**
+ * @brief Context constructor.
+ *
+ * @return TIGER_ctx
+ */
+TIGER_ctx TIGER_mk_ctx(void);
+
+/**
+ * @brief Free context and everything allocated in it.
+ *
+ * @param[in] ctx
+ */
+void TIGER_free_ctx(TIGER_ctx ctx);
+
+/**
+ * @brief Set current context of calling thread.
+ *
+ * Threads start with the process-wide default context, a thread compiling
+ * beside others must use its own.
+ *
+ * @param[in] ctx   NULL for default context.
+ */
+void TIGER_use(TIGER_ctx ctx);
+
+/**
+ * @brief Get current context of calling thread.
+ *
+ * @return TIGER_ctx
+ */
+TIGER_ctx TIGER_cur(void);
+
+/**
+ * @brief Set where UTL_error() jumps on calling thread, over ctx->bail.
+ *
+ * A helper thread working in a context another thread owns must not jump
+ * to the owner's stack, it sets its own.
+ *
+ * @param[in] bail  NULL to use ctx->bail again.
+ */
+void TIGER_bail_thread(jmp_buf *bail);
+
+/**
+ * @brief Get where UTL_error() jumps on calling thread.
+ *
+ * @return jmp_buf*     NULL to exit.
+ */
+jmp_buf *TIGER_bail(void);
+
+/**
+ * @brief Get stream for messages of current context.
+ *
+ * @return FILE*
+ */
+FILE *TIGER_out(void);
+
+/**
+ * @brief Allocate zeroed module state, freed with its context.
+ *
+ * @param[in] size
+ * @return void*
+ */
+void *TIGER_mk_state(size_t size);
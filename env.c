@@ -10,7 +10,7 @@
 
 ENV_entry ENV_mk_entry_var(TR_access access, TY_type type)
 {
-    ENV_entry p = UTL_alloc(sizeof(*p));
+    ENV_entry p = UTL_alloc_as(UTL_tag_bind, sizeof(*p));
 
     p->kind         = ENV_KIND_ENTRY_VAR;
     p->u.var.access = access;
@@ -22,7 +22,7 @@ ENV_entry ENV_mk_entry_var(TR_access access, TY_type type)
 ENV_entry ENV_mk_entry_func(TR_level level, TMP_label label,
                             TY_type_list paras, TY_type ret)
 {
-    ENV_entry p = UTL_alloc(sizeof(*p));
+    ENV_entry p = UTL_alloc_as(UTL_tag_bind, sizeof(*p));
 
     p->kind         = ENV_KIND_ENTRY_FUNC;
     p->u.func.level = level;
@@ -0,0 +1,613 @@
+/****************************************************************************
+ * Includes
+ ****************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "flat.h"
+#include "util.h"
+#include "visit.h"
+
+/****************************************************************************
+ * Definitions
+ ****************************************************************************/
+
+#define FLT_MIN_SIZE    64  /*< first size of extra, symbol and string arrays */
+
+/**
+ * @brief Flatten walk, context of FLT_put_step().
+ */
+typedef struct FLT_putter_
+{
+    FLT_tree    t;
+    SYM_side    ids;    /*< symbol to its index */
+} FLT_putter;
+
+/**
+ * @brief Locals of a frame being flattened.
+ */
+typedef struct FLT_local_
+{
+    uint32_t    index;      /*< node, or list (0 if empty) */
+    int         slot;       /*< child slots passed */
+    uint32_t    kids[3];    /*< node or list of each slot of a node */
+} FLT_local;
+
+/****************************************************************************
+ * Private Functions: flatten
+ ****************************************************************************/
+
+/**
+ * @brief Grow array to hold n elements.
+ */
+static void *FLT_grow(void *p, int *cap, int n, int size)
+{
+    if (n <= *cap)
+        return p;
+
+    if (!*cap)
+        *cap = FLT_MIN_SIZE;
+    while (*cap < n)
+        *cap *= 2;
+
+    p = realloc(p, (size_t)*cap * size);
+    if (!p)
+        UTL_error(UTL_NOPOS, "run out of memory");
+
+    return p;
+}
+
+/**
+ * @brief Append node, fields are zero.
+ */
+static FLT_node FLT_add(FLT_tree t, FLT_class class, int kind, Apos pos)
+{
+    FLT_node n = t->n++;
+
+    if (t->n > t->cap) {
+        t->cap   *= 2;
+        t->kind  = realloc(t->kind, t->cap * sizeof(t->kind[0]));
+        t->pos   = realloc(t->pos, t->cap * sizeof(t->pos[0]));
+        t->a     = realloc(t->a, t->cap * sizeof(t->a[0]));
+        t->b     = realloc(t->b, t->cap * sizeof(t->b[0]));
+        t->c     = realloc(t->c, t->cap * sizeof(t->c[0]));
+        if (!t->kind || !t->pos || !t->a || !t->b || !t->c)
+            UTL_error(UTL_NOPOS, "run out of memory");
+    }
+
+    t->kind[n] = class << 4 | kind;
+    t->pos[n]  = pos;
+    t->a[n]    = 0;
+    t->b[n]    = 0;
+    t->c[n]    = 0;
+
+    return n;
+}
+
+/**
+ * @brief Reserve n extra words, zeroed, return first.
+ */
+static uint32_t FLT_reserve(FLT_tree t, int n)
+{
+    uint32_t at = t->nextra;
+
+    t->extra = FLT_grow(t->extra, &t->cextra, t->nextra + n,
+                        sizeof(t->extra[0]));
+    memset(t->extra + at, 0, n * sizeof(t->extra[0]));
+    t->nextra += n;
+
+    return at;
+}
+
+/**
+ * @brief Index of symbol, each symbol is stored once.
+ */
+static uint32_t FLT_symbol(FLT_tree t, SYM_side ids, SYM_symbol s)
+{
+    uintptr_t i;
+
+    if (!s)
+        return 0;
+
+    i = (uintptr_t)SYM_side_get(ids, s);
+    if (!i) {
+        t->syms = FLT_grow(t->syms, &t->csym, t->nsym + 1, sizeof(t->syms[0]));
+        t->syms[i = t->nsym++] = s;
+        SYM_side_set(ids, s, (void *)i);
+    }
+
+    return i;
+}
+
+static uint32_t FLT_string(FLT_tree t, const char *s)
+{
+    t->strs = FLT_grow(t->strs, &t->cstr, t->nstr + 1, sizeof(t->strs[0]));
+    t->strs[t->nstr] = s;
+
+    return t->nstr++;
+}
+
+/* Nodes are added on entering them, lists are reserved then too. Children
+ * may grow the arrays, so their index is stored once they are done.
+ */
+
+/**
+ * @brief Add node or reserve list for a frame, fields of children later.
+ *
+ * @return uint32_t     Node, or list (0 if empty).
+ */
+static uint32_t FLT_enter(FLT_tree t, SYM_side ids, VIS_class class,
+                          void *node)
+{
+    FLT_node n = 0;
+    FLT_list l;
+    int len;
+
+    switch (class) {
+        case VIS_exp: {
+            AST_exp e = node;
+
+            n = FLT_add(t, FLT_class_exp, e->kind, e->pos);
+            t->ptr_bytes += sizeof(*e);
+
+            switch (e->kind) {
+                case AST_kind_exp_int:
+                    t->a[n] = e->u.int_;
+                    break;
+                case AST_kind_exp_str:
+                    t->a[n] = FLT_string(t, e->u.str_);
+                    break;
+                case AST_kind_exp_call:
+                    t->a[n] = FLT_symbol(t, ids, e->u.call.func);
+                    break;
+                case AST_kind_exp_op:
+                    t->a[n] = e->u.op.oper;
+                    break;
+                case AST_kind_exp_array:
+                    t->a[n] = FLT_symbol(t, ids, e->u.array.type);
+                    break;
+                case AST_kind_exp_record:
+                    t->a[n] = FLT_symbol(t, ids, e->u.record.type);
+                    break;
+                case AST_kind_exp_for:
+                    t->a[n] = FLT_symbol(t, ids, e->u.for_.var);
+                    if (e->u.for_.escape)
+                        t->kind[n] |= FLT_ESCAPE;
+                    l = FLT_reserve(t, 2);
+                    t->c[n] = l;
+                    break;
+                case AST_kind_exp_var:
+                case AST_kind_exp_nil:
+                case AST_kind_exp_break:
+                case AST_kind_exp_seq:
+                case AST_kind_exp_assign:
+                case AST_kind_exp_if:
+                case AST_kind_exp_while:
+                case AST_kind_exp_let:
+                    break;
+                default:
+                    UTL_error(e->pos, "unkown exp kind(%d)", e->kind);
+            }
+            return n;
+        }
+
+        case VIS_dec: {
+            AST_dec d = node;
+
+            n = FLT_add(t, FLT_class_dec, d->kind, d->pos);
+            t->ptr_bytes += sizeof(*d);
+
+            switch (d->kind) {
+                case AST_kind_dec_var:
+                    t->a[n] = FLT_symbol(t, ids, d->u.var.name);
+                    t->b[n] = FLT_symbol(t, ids, d->u.var.type);
+                    if (d->u.var.escape)
+                        t->kind[n] |= FLT_ESCAPE;
+                    break;
+                case AST_kind_dec_type:
+                    t->a[n] = FLT_symbol(t, ids, d->u.type.name);
+                    break;
+                case AST_kind_dec_func:
+                    t->a[n] = FLT_symbol(t, ids, d->u.func.name);
+                    t->b[n] = FLT_symbol(t, ids, d->u.func.ret);
+                    l = FLT_reserve(t, 2);
+                    t->c[n] = l;
+                    break;
+            }
+            return n;
+        }
+
+        case VIS_var: {
+            AST_var v = node;
+
+            n = FLT_add(t, FLT_class_var, v->kind, v->pos);
+            t->ptr_bytes += sizeof(*v);
+
+            if (v->kind == AST_kind_var_base)
+                t->a[n] = FLT_symbol(t, ids, v->u.base.name);
+            else if (v->kind == AST_kind_var_field)
+                t->a[n] = FLT_symbol(t, ids, v->u.field.name);
+            return n;
+        }
+
+        case VIS_type: {
+            AST_type ty = node;
+
+            n = FLT_add(t, FLT_class_type, ty->kind, ty->pos);
+            t->ptr_bytes += sizeof(*ty);
+
+            if (ty->kind == AST_kind_type_name)
+                t->a[n] = FLT_symbol(t, ids, ty->u.name);
+            else if (ty->kind == AST_kind_type_array)
+                t->a[n] = FLT_symbol(t, ids, ty->u.array);
+            return n;
+        }
+
+        case VIS_para: {
+            AST_para p = node;
+
+            n = FLT_add(t, FLT_class_para, 0, p->pos);
+            t->a[n] = FLT_symbol(t, ids, p->name);
+            t->b[n] = FLT_symbol(t, ids, p->type);
+            if (p->escape)
+                t->kind[n] |= FLT_ESCAPE;
+            return n;
+        }
+
+        case VIS_arg:
+            n = FLT_add(t, FLT_class_arg, 0, UTL_NOPOS);
+            t->a[n] = FLT_symbol(t, ids, ((AST_arg)node)->name);
+            return n;
+
+        case VIS_exp_list: {
+            AST_exp_list list = node;
+
+            if (!(len = AST_LEN(list)))
+                return 0;
+            t->ptr_bytes += sizeof(*list) + list->cap * sizeof(list->items[0]);
+            break;
+        }
+
+        case VIS_dec_list: {
+            AST_dec_list list = node;
+
+            if (!(len = AST_LEN(list)))
+                return 0;
+            t->ptr_bytes += sizeof(*list) + list->cap * sizeof(list->items[0]);
+            break;
+        }
+
+        case VIS_para_list: {
+            AST_para_list list = node;
+
+            if (!(len = AST_LEN(list)))
+                return 0;
+            t->ptr_bytes += sizeof(*list) + list->cap * sizeof(list->items[0])
+                          + len * sizeof(*list->items[0]);
+            break;
+        }
+
+        case VIS_arg_list: {
+            AST_arg_list list = node;
+
+            if (!(len = AST_LEN(list)))
+                return 0;
+            t->ptr_bytes += sizeof(*list) + list->cap * sizeof(list->items[0])
+                          + len * sizeof(*list->items[0]);
+            break;
+        }
+    }
+
+    l = FLT_reserve(t, 1 + len);
+    t->extra[l] = len;
+    return l;
+}
+
+/**
+ * @brief Store children of a frame's node, absent ones are 0.
+ */
+static void FLT_leave(FLT_tree t, VIS_class class, void *node, FLT_node n,
+                      uint32_t *kids)
+{
+    switch (class) {
+        case VIS_exp:
+            switch (((AST_exp)node)->kind) {
+                case AST_kind_exp_call:
+                case AST_kind_exp_record:
+                    t->b[n] = kids[0];
+                    break;
+                case AST_kind_exp_op:
+                case AST_kind_exp_array:
+                    t->b[n] = kids[0];
+                    t->c[n] = kids[1];
+                    break;
+                case AST_kind_exp_for:
+                    t->b[n] = kids[0];
+                    t->extra[t->c[n]]     = kids[1];
+                    t->extra[t->c[n] + 1] = kids[2];
+                    break;
+                case AST_kind_exp_var:
+                case AST_kind_exp_seq:
+                    t->a[n] = kids[0];
+                    break;
+                case AST_kind_exp_assign:
+                case AST_kind_exp_while:
+                case AST_kind_exp_let:
+                    t->a[n] = kids[0];
+                    t->b[n] = kids[1];
+                    break;
+                case AST_kind_exp_if:
+                    t->a[n] = kids[0];
+                    t->b[n] = kids[1];
+                    t->c[n] = kids[2];
+                    break;
+                default:
+                    break;
+            }
+            break;
+
+        case VIS_dec:
+            switch (((AST_dec)node)->kind) {
+                case AST_kind_dec_var:
+                    t->c[n] = kids[0];
+                    break;
+                case AST_kind_dec_type:
+                    t->b[n] = kids[0];
+                    break;
+                case AST_kind_dec_func:
+                    t->extra[t->c[n]]     = kids[0];
+                    t->extra[t->c[n] + 1] = kids[1];
+                    break;
+            }
+            break;
+
+        case VIS_var:
+            if (((AST_var)node)->kind == AST_kind_var_index) {
+                t->a[n] = kids[0];
+                t->b[n] = kids[1];
+            } else {
+                t->b[n] = kids[0];
+            }
+            break;
+
+        case VIS_type:
+            if (((AST_type)node)->kind == AST_kind_type_record)
+                t->a[n] = kids[0];
+            break;
+
+        case VIS_arg:
+            t->b[n] = kids[0];
+            break;
+
+        default:
+            break;
+    }
+}
+
+static void FLT_put_step(VIS_walk w, VIS_frame *f, void *ctx)
+{
+    FLT_putter *z = ctx;
+    FLT_local  *l = VIS_local(f);
+    bool        list = f->class >= VIS_exp_list;
+    VIS_class   class;
+    void *      child;
+
+    if (f->step == 0) {
+        l->index = FLT_enter(z->t, z->ids, f->class, f->node);
+    } else {
+        FLT_node x = ((FLT_local *)VIS_done(w))->index;
+
+        if (list)
+            z->t->extra[l->index + l->slot] = x;
+        else
+            l->kids[l->slot - 1] = x;
+    }
+
+    // absent children are left 0, f is stale once a child is pushed.
+    while (VIS_slot(f->class, f->node, l->slot, &class, &child)) {
+        l->slot++;
+        if (child) {
+            VIS_push(w, class, child);
+            return;
+        }
+    }
+
+    if (!list)
+        FLT_leave(z->t, f->class, f->node, l->index, l->kids);
+}
+
+/****************************************************************************
+ * Private Functions: walk
+ ****************************************************************************/
+
+/**
+ * @brief Push children of node, and elements of its lists, on stack.
+ *
+ * @return int  Stack depth after.
+ */
+static int FLT_push_kids(FLT_tree t, FLT_node n, FLT_node *stack, int sp)
+{
+    FLT_list l = 0;
+    int i;
+
+#define FLT_PUSH(x) ({ FLT_node c_ = (x); if (c_) stack[sp++] = c_; })
+
+    switch (FLT_class_of(t, n)) {
+        case FLT_class_exp:
+            switch (FLT_kind(t, n)) {
+                case AST_kind_exp_var:
+                    FLT_PUSH(FLT_exp_var(t, n));
+                    break;
+                case AST_kind_exp_call:
+                    l = FLT_exp_call_args(t, n);
+                    break;
+                case AST_kind_exp_record:
+                    l = FLT_exp_record_args(t, n);
+                    break;
+                case AST_kind_exp_seq:
+                    l = FLT_exp_seq(t, n);
+                    break;
+                case AST_kind_exp_op:
+                    FLT_PUSH(FLT_exp_op_left(t, n));
+                    FLT_PUSH(FLT_exp_op_right(t, n));
+                    break;
+                case AST_kind_exp_array:
+                    FLT_PUSH(FLT_exp_array_size(t, n));
+                    FLT_PUSH(FLT_exp_array_init(t, n));
+                    break;
+                case AST_kind_exp_assign:
+                    FLT_PUSH(FLT_exp_assign_var(t, n));
+                    FLT_PUSH(FLT_exp_assign_exp(t, n));
+                    break;
+                case AST_kind_exp_while:
+                    FLT_PUSH(FLT_exp_while_cond(t, n));
+                    FLT_PUSH(FLT_exp_while_body(t, n));
+                    break;
+                case AST_kind_exp_if:
+                    FLT_PUSH(FLT_exp_if_cond(t, n));
+                    FLT_PUSH(FLT_exp_if_then(t, n));
+                    FLT_PUSH(FLT_exp_if_else(t, n));
+                    break;
+                case AST_kind_exp_for:
+                    FLT_PUSH(FLT_exp_for_lo(t, n));
+                    FLT_PUSH(FLT_exp_for_hi(t, n));
+                    FLT_PUSH(FLT_exp_for_body(t, n));
+                    break;
+                case AST_kind_exp_let:
+                    l = FLT_exp_let_decs(t, n);
+                    for (i = 0; i < FLT_len(t, l); i++)
+                        FLT_PUSH(FLT_at(t, l, i));
+                    l = FLT_exp_let_body(t, n);
+                    break;
+            }
+            break;
+
+        case FLT_class_dec:
+            switch (FLT_kind(t, n)) {
+                case AST_kind_dec_var:
+                    FLT_PUSH(FLT_dec_var_init(t, n));
+                    break;
+                case AST_kind_dec_type:
+                    FLT_PUSH(FLT_dec_type_type(t, n));
+                    break;
+                case AST_kind_dec_func:
+                    FLT_PUSH(FLT_dec_func_body(t, n));
+                    l = FLT_dec_func_paras(t, n);
+                    break;
+            }
+            break;
+
+        case FLT_class_var:
+            if (FLT_kind(t, n) == AST_kind_var_index)
+                FLT_PUSH(FLT_var_index_exp(t, n));
+            FLT_PUSH(FLT_var_suffix(t, n));
+            break;
+
+        case FLT_class_type:
+            if (FLT_kind(t, n) == AST_kind_type_record)
+                l = FLT_type_record(t, n);
+            break;
+
+        case FLT_class_arg:
+            FLT_PUSH(FLT_arg_exp(t, n));
+            break;
+
+        case FLT_class_para:
+            break;
+    }
+
+    for (i = 0; i < FLT_len(t, l); i++)
+        FLT_PUSH(FLT_at(t, l, i));
+
+#undef FLT_PUSH
+
+    return sp;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+FLT_tree FLT_flatten(AST_exp root)
+{
+    FLT_tree t = calloc(1, sizeof(*t));
+    FLT_putter z = { t, SYM_mk_side() };
+
+    if (!t)
+        UTL_error(UTL_NOPOS, "run out of memory");
+
+    // node 0 is none, list 0 is empty, symbol and string 0 are NULL.
+    t->cap  = AST_count(root) + 1;
+    t->kind = malloc(t->cap * sizeof(t->kind[0]));
+    t->pos  = malloc(t->cap * sizeof(t->pos[0]));
+    t->a    = malloc(t->cap * sizeof(t->a[0]));
+    t->b    = malloc(t->cap * sizeof(t->b[0]));
+    t->c    = malloc(t->cap * sizeof(t->c[0]));
+    if (!t->kind || !t->pos || !t->a || !t->b || !t->c)
+        UTL_error(UTL_NOPOS, "run out of memory");
+
+    FLT_add(t, FLT_class_exp, 0, UTL_NOPOS);
+    FLT_reserve(t, 1);
+    t->extra[0] = 0;
+    t->syms = FLT_grow(NULL, &t->csym, 1, sizeof(t->syms[0]));
+    t->syms[t->nsym++] = NULL;
+    FLT_string(t, NULL);
+
+    // root is the first node added.
+    if (root) {
+        VIS_run(VIS_mk_walk(FLT_put_step, sizeof(FLT_local), &z), VIS_exp,
+                root);
+        t->root = 1;
+    }
+    return t;
+}
+
+void FLT_free(FLT_tree t)
+{
+    free(t->kind);
+    free(t->pos);
+    free(t->a);
+    free(t->b);
+    free(t->c);
+    free(t->extra);
+    free(t->syms);
+    free(t->strs);
+    free(t);
+}
+
+int FLT_count(FLT_tree t)
+{
+    FLT_node *stack;
+    int n = 0, sp = 0;
+
+    if (!t->root)
+        return 0;
+
+    // every node has one parent, stack holds each at most once.
+    stack = malloc(t->n * sizeof(*stack));
+    if (!stack)
+        UTL_error(UTL_NOPOS, "run out of memory");
+
+    stack[sp++] = t->root;
+    while (sp > 0) {
+        FLT_node x = stack[--sp];
+
+        sp = FLT_push_kids(t, x, stack, sp);
+        n++;
+    }
+
+    free(stack);
+    return n;
+}
+
+void FLT_report(FILE *out, FLT_tree t)
+{
+    size_t node = sizeof(t->kind[0]) + sizeof(t->pos[0]) + sizeof(t->a[0])
+                + sizeof(t->b[0]) + sizeof(t->c[0]);
+    size_t bytes = t->cap * node + t->cextra * sizeof(t->extra[0])
+                 + t->csym * sizeof(t->syms[0]) + t->cstr * sizeof(t->strs[0]);
+
+    fprintf(out, "flat ast: %d nodes, %d extra words, %zu bytes, "
+                 "pointer ast %zu bytes\n",
+            t->n - 1, t->nextra - 1, bytes, t->ptr_bytes);
+}
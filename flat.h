@@ -0,0 +1,253 @@
+#pragma once
+
+/****************************************************************************
+ * Includes
+ ****************************************************************************/
+
+#include <stdint.h>
+#include <stdio.h>
+#include "ast.h"
+#include "symbol.h"
+
+/****************************************************************************
+ * Definitions
+ ****************************************************************************/
+
+/**
+ * @brief Node of flat tree, index into its arrays, 0 is none.
+ */
+typedef uint32_t FLT_node;
+
+/**
+ * @brief List of nodes, index of its length in extra words, 0 is empty.
+ */
+typedef uint32_t FLT_list;
+
+typedef enum {
+    FLT_class_exp,
+    FLT_class_dec,
+    FLT_class_var,
+    FLT_class_type,
+    FLT_class_para,
+    FLT_class_arg,
+} FLT_class;
+
+#define FLT_ESCAPE  0x80    /*< flag in kind byte, escape of var and for */
+
+/**
+ * @brief Flat tree, struct of arrays.
+ *
+ * Node i is kind[i], pos[i] and three 32-bit fields a[i], b[i], c[i]:
+ * child nodes, lists, symbol and string indexes or plain values, as the
+ * accessors below tell. Nodes with four fields keep the last two in extra
+ * words, c is where. Nodes are laid out in pre-order, a subtree is one
+ * run of indexes.
+ */
+typedef struct FLT_tree_
+{
+    uint8_t *       kind;   /*< class << 4 | ast kind, and flags */
+    Apos *          pos;
+    uint32_t *      a;
+    uint32_t *      b;
+    uint32_t *      c;
+    int             n;      /*< nodes, node 0 included */
+    int             cap;
+    uint32_t *      extra;  /*< lists, fields beyond three */
+    int             nextra, cextra;
+    SYM_symbol *    syms;   /*< symbol index to symbol, 0 is NULL */
+    int             nsym, csym;
+    const char **   strs;   /*< string index to literal, 0 is NULL */
+    int             nstr, cstr;
+    FLT_node        root;
+    size_t          ptr_bytes;  /*< bytes of pointer tree flattened */
+} *FLT_tree;
+
+/****************************************************************************
+ * Public: node accessors
+ ****************************************************************************/
+
+static inline FLT_class FLT_class_of(FLT_tree t, FLT_node n)
+{
+    return t->kind[n] >> 4 & 7;
+}
+
+/* kind within class, an AST_kind_* value */
+static inline int FLT_kind(FLT_tree t, FLT_node n)   { return t->kind[n] & 0xf; }
+static inline Apos FLT_pos(FLT_tree t, FLT_node n)   { return t->pos[n]; }
+static inline bool FLT_escape(FLT_tree t, FLT_node n)
+{
+    return t->kind[n] & FLT_ESCAPE;
+}
+
+static inline int FLT_len(FLT_tree t, FLT_list l)    { return t->extra[l]; }
+static inline FLT_node FLT_at(FLT_tree t, FLT_list l, int i)
+{
+    return t->extra[l + 1 + i];
+}
+
+static inline SYM_symbol FLT_sym(FLT_tree t, uint32_t i) { return t->syms[i]; }
+
+/* expressions, as AST_exp u */
+static inline FLT_node FLT_exp_var(FLT_tree t, FLT_node n)   { return t->a[n]; }
+static inline int FLT_exp_int(FLT_tree t, FLT_node n)        { return t->a[n]; }
+static inline const char *FLT_exp_str(FLT_tree t, FLT_node n)
+{
+    return t->strs[t->a[n]];
+}
+static inline SYM_symbol FLT_exp_call_func(FLT_tree t, FLT_node n)
+{
+    return t->syms[t->a[n]];
+}
+static inline FLT_list FLT_exp_call_args(FLT_tree t, FLT_node n)  { return t->b[n]; }
+static inline AST_kind_op FLT_exp_op_oper(FLT_tree t, FLT_node n) { return t->a[n]; }
+static inline FLT_node FLT_exp_op_left(FLT_tree t, FLT_node n)    { return t->b[n]; }
+static inline FLT_node FLT_exp_op_right(FLT_tree t, FLT_node n)   { return t->c[n]; }
+static inline SYM_symbol FLT_exp_array_type(FLT_tree t, FLT_node n)
+{
+    return t->syms[t->a[n]];
+}
+static inline FLT_node FLT_exp_array_size(FLT_tree t, FLT_node n) { return t->b[n]; }
+static inline FLT_node FLT_exp_array_init(FLT_tree t, FLT_node n) { return t->c[n]; }
+static inline SYM_symbol FLT_exp_record_type(FLT_tree t, FLT_node n)
+{
+    return t->syms[t->a[n]];
+}
+static inline FLT_list FLT_exp_record_args(FLT_tree t, FLT_node n) { return t->b[n]; }
+static inline FLT_list FLT_exp_seq(FLT_tree t, FLT_node n)         { return t->a[n]; }
+static inline FLT_node FLT_exp_assign_var(FLT_tree t, FLT_node n)  { return t->a[n]; }
+static inline FLT_node FLT_exp_assign_exp(FLT_tree t, FLT_node n)  { return t->b[n]; }
+static inline FLT_node FLT_exp_if_cond(FLT_tree t, FLT_node n)     { return t->a[n]; }
+static inline FLT_node FLT_exp_if_then(FLT_tree t, FLT_node n)     { return t->b[n]; }
+static inline FLT_node FLT_exp_if_else(FLT_tree t, FLT_node n)     { return t->c[n]; }
+static inline FLT_node FLT_exp_while_cond(FLT_tree t, FLT_node n)  { return t->a[n]; }
+static inline FLT_node FLT_exp_while_body(FLT_tree t, FLT_node n)  { return t->b[n]; }
+static inline SYM_symbol FLT_exp_for_var(FLT_tree t, FLT_node n)
+{
+    return t->syms[t->a[n]];
+}
+static inline FLT_node FLT_exp_for_lo(FLT_tree t, FLT_node n)   { return t->b[n]; }
+static inline FLT_node FLT_exp_for_hi(FLT_tree t, FLT_node n)
+{
+    return t->extra[t->c[n]];
+}
+static inline FLT_node FLT_exp_for_body(FLT_tree t, FLT_node n)
+{
+    return t->extra[t->c[n] + 1];
+}
+static inline FLT_list FLT_exp_let_decs(FLT_tree t, FLT_node n) { return t->a[n]; }
+static inline FLT_list FLT_exp_let_body(FLT_tree t, FLT_node n) { return t->b[n]; }
+
+/* declarations, as AST_dec u */
+static inline SYM_symbol FLT_dec_var_name(FLT_tree t, FLT_node n)
+{
+    return t->syms[t->a[n]];
+}
+static inline SYM_symbol FLT_dec_var_type(FLT_tree t, FLT_node n)
+{
+    return t->syms[t->b[n]];
+}
+static inline FLT_node FLT_dec_var_init(FLT_tree t, FLT_node n) { return t->c[n]; }
+static inline SYM_symbol FLT_dec_type_name(FLT_tree t, FLT_node n)
+{
+    return t->syms[t->a[n]];
+}
+static inline FLT_node FLT_dec_type_type(FLT_tree t, FLT_node n) { return t->b[n]; }
+static inline SYM_symbol FLT_dec_func_name(FLT_tree t, FLT_node n)
+{
+    return t->syms[t->a[n]];
+}
+static inline SYM_symbol FLT_dec_func_ret(FLT_tree t, FLT_node n)
+{
+    return t->syms[t->b[n]];
+}
+static inline FLT_list FLT_dec_func_paras(FLT_tree t, FLT_node n)
+{
+    return t->extra[t->c[n]];
+}
+static inline FLT_node FLT_dec_func_body(FLT_tree t, FLT_node n)
+{
+    return t->extra[t->c[n] + 1];
+}
+
+/* variables, as AST_var u, every kind has a suffix */
+static inline SYM_symbol FLT_var_base_name(FLT_tree t, FLT_node n)
+{
+    return t->syms[t->a[n]];
+}
+static inline FLT_node FLT_var_index_exp(FLT_tree t, FLT_node n) { return t->a[n]; }
+static inline SYM_symbol FLT_var_field_name(FLT_tree t, FLT_node n)
+{
+    return t->syms[t->a[n]];
+}
+static inline FLT_node FLT_var_suffix(FLT_tree t, FLT_node n)    { return t->b[n]; }
+
+/* type definitions, as AST_type u */
+static inline SYM_symbol FLT_type_name(FLT_tree t, FLT_node n)
+{
+    return t->syms[t->a[n]];
+}
+static inline SYM_symbol FLT_type_array(FLT_tree t, FLT_node n)
+{
+    return t->syms[t->a[n]];
+}
+static inline FLT_list FLT_type_record(FLT_tree t, FLT_node n)   { return t->a[n]; }
+
+/* parameters and arguments, as AST_para and AST_arg */
+static inline SYM_symbol FLT_para_name(FLT_tree t, FLT_node n)
+{
+    return t->syms[t->a[n]];
+}
+static inline SYM_symbol FLT_para_type(FLT_tree t, FLT_node n)
+{
+    return t->syms[t->b[n]];
+}
+static inline SYM_symbol FLT_arg_name(FLT_tree t, FLT_node n)
+{
+    return t->syms[t->a[n]];
+}
+static inline FLT_node FLT_arg_exp(FLT_tree t, FLT_node n)       { return t->b[n]; }
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/**
+ * @brief Copy pointer tree into a flat one.
+ *
+ * Arrays are sized by AST_count() first, then filled in one pre-order walk.
+ *
+ * @param[in] root
+ * @return FLT_tree     Malloced, free by FLT_free().
+ */
+FLT_tree FLT_flatten(AST_exp root);
+
+/**
+ * @brief Free flat tree.
+ *
+ * @param[in] t
+ */
+void FLT_free(FLT_tree t);
+
+/**
+ * @brief Count nodes, same walk as AST_count() on flat arrays.
+ *
+ * @param[in] t
+ * @return int  Nodes under root, lists not counted.
+ */
+int FLT_count(FLT_tree t);
+
+/**
+ * @brief Print flat tree, same text as AST_print().
+ *
+ * @param[in] out
+ * @param[in] t
+ */
+void FLT_print(FILE *out, FLT_tree t);
+
+/**
+ * @brief Show node count and memory, beside the pointer tree's.
+ *
+ * @param[in] out
+ * @param[in] t
+ */
+void FLT_report(FILE *out, FLT_tree t);
@@ -46,7 +46,7 @@ struct FRM_access_list_ { FRM_access head; FRM_access_list tail; };
  */
 static FRM_access FRM_alloc_in_frame(int offset)
 {
-    FRM_access p = UTL_alloc(sizeof(*p));
+    FRM_access p = UTL_alloc_as(UTL_tag_frame, sizeof(*p));
 
     p->kind = FRM_kind_in_frame;
     p->u.offset = offset;
@@ -62,7 +62,7 @@ static FRM_access FRM_alloc_in_frame(int offset)
  */
 static FRM_access FRM_alloc_in_reg(TMP_temp reg)
 {
-    FRM_access p = UTL_alloc(sizeof(*p));
+    FRM_access p = UTL_alloc_as(UTL_tag_frame, sizeof(*p));
 
     p->kind = FRM_kind_in_reg;
     p->u.reg = reg;
@@ -79,7 +79,7 @@ static FRM_access FRM_alloc_in_reg(TMP_temp reg)
  */
 static FRM_frame_list FRM_mk_access_list(FRM_access head, FRM_access_list tail)
 {
-    FRM_access_list p = UTL_alloc(sizeof(*p));
+    FRM_access_list p = UTL_alloc_as(UTL_tag_frame, sizeof(*p));
 
     p->head = head;
     p->tail = tail;
@@ -95,7 +95,7 @@ static FRM_frame_list FRM_mk_access_list(FRM_access head, FRM_access_list tail)
  */
 static FRM_frame FRM_mk_frame_(TMP_label name)
 {
-    FRM_frame p = UTL_alloc(sizeof(*p));
+    FRM_frame p = UTL_alloc_as(UTL_tag_frame, sizeof(*p));
 
     p->name   = name;
     p->paras  = NULL;
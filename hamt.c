@@ -0,0 +1,191 @@
+/****************************************************************************
+ * Includes
+ ****************************************************************************/
+
+#include <string.h>
+#include "hamt.h"
+#include "util.h"
+
+/****************************************************************************
+ * Definitions
+ ****************************************************************************/
+
+#define HMT_BITS    5
+#define HMT_MASK    ((1u << HMT_BITS) - 1)
+#define HMT_DEPTH   32  /*< shift where hash is used up, collision node */
+
+typedef struct HMT_entry_ HMT_entry;
+
+/**
+ * @brief Slot of a node, key NULL means value is a child node.
+ */
+struct HMT_entry_
+{
+    unsigned    hash;
+    void *      key;
+    void *      value;
+};
+
+/**
+ * @brief Trie node.
+ *
+ * Only present slots are stored, bitmap tells which of the 32 are present.
+ * Collision nodes (below HMT_DEPTH) ignore bitmap and keep a plain array.
+ */
+struct HMT_node_
+{
+    unsigned    bitmap;
+    int         n;
+    HMT_entry   e[];
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static HMT_map HMT_mk_node(unsigned bitmap, int n)
+{
+    HMT_map p = UTL_alloc_as(UTL_tag_bind, sizeof(*p) + n * sizeof(p->e[0]));
+
+    p->bitmap = bitmap;
+    p->n      = n;
+
+    return p;
+}
+
+/**
+ * @brief Copy node with one slot inserted.
+ */
+static HMT_map HMT_insert_at(HMT_map m, unsigned bit, int idx, HMT_entry e)
+{
+    HMT_map p = HMT_mk_node(m->bitmap | bit, m->n + 1);
+
+    memcpy(p->e, m->e, idx * sizeof(e));
+    p->e[idx] = e;
+    memcpy(p->e + idx + 1, m->e + idx, (m->n - idx) * sizeof(e));
+
+    return p;
+}
+
+/**
+ * @brief Copy node with one slot replaced.
+ */
+static HMT_map HMT_replace_at(HMT_map m, int idx, HMT_entry e)
+{
+    HMT_map p = HMT_mk_node(m->bitmap, m->n);
+
+    memcpy(p->e, m->e, m->n * sizeof(e));
+    p->e[idx] = e;
+
+    return p;
+}
+
+static HMT_map HMT_insert(HMT_map m, int shift, HMT_entry e)
+{
+    unsigned bit;
+    int idx;
+
+    if (!m)
+        m = HMT_mk_node(0, 0);
+
+    // hash is used up, plain array.
+    if (shift >= HMT_DEPTH) {
+        for (idx = 0; idx < m->n; idx++) {
+            if (m->e[idx].key == e.key)
+                return HMT_replace_at(m, idx, e);
+        }
+        return HMT_insert_at(m, 0, m->n, e);
+    }
+
+    bit = 1u << ((e.hash >> shift) & HMT_MASK);
+    idx = __builtin_popcount(m->bitmap & (bit - 1));
+
+    if (!(m->bitmap & bit))
+        return HMT_insert_at(m, bit, idx, e);
+
+    if (!m->e[idx].key) {
+        HMT_entry child = { 0, NULL, NULL };
+
+        child.value = HMT_insert(m->e[idx].value, shift + HMT_BITS, e);
+        return HMT_replace_at(m, idx, child);
+    }
+
+    if (m->e[idx].key == e.key)
+        return HMT_replace_at(m, idx, e);
+
+    // two keys share this slot, push both down.
+    {
+        HMT_entry child = { 0, NULL, NULL };
+        HMT_map sub;
+
+        sub = HMT_insert(NULL, shift + HMT_BITS, m->e[idx]);
+        sub = HMT_insert(sub, shift + HMT_BITS, e);
+
+        child.value = sub;
+        return HMT_replace_at(m, idx, child);
+    }
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+HMT_map HMT_empty(void)
+{
+    return NULL;
+}
+
+HMT_map HMT_enter(HMT_map m, unsigned hash, void *key, void *value)
+{
+    HMT_entry e;
+
+    if (!key)
+        UTL_error(UTL_NOPOS, "enter null key to map");
+
+    e.hash  = hash;
+    e.key   = key;
+    e.value = value;
+
+    return HMT_insert(m, 0, e);
+}
+
+void *HMT_look(HMT_map m, unsigned hash, void *key)
+{
+    int shift, idx;
+    unsigned bit;
+
+    for (shift = 0; m; shift += HMT_BITS) {
+        if (shift >= HMT_DEPTH) {
+            for (idx = 0; idx < m->n; idx++) {
+                if (m->e[idx].key == key)
+                    return m->e[idx].value;
+            }
+            return NULL;
+        }
+
+        bit = 1u << ((hash >> shift) & HMT_MASK);
+        if (!(m->bitmap & bit))
+            return NULL;
+
+        idx = __builtin_popcount(m->bitmap & (bit - 1));
+        if (m->e[idx].key)
+            return m->e[idx].key == key ? m->e[idx].value : NULL;
+
+        m = m->e[idx].value;
+    }
+
+    return NULL;
+}
+
+int HMT_size(HMT_map m)
+{
+    int i, n = 0;
+
+    if (!m)
+        return 0;
+
+    for (i = 0; i < m->n; i++)
+        n += m->e[i].key ? 1 : HMT_size(m->e[i].value);
+
+    return n;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+/****************************************************************************
+ * Definitions
+ ****************************************************************************/
+
+/**
+ * @brief Persistent hash array mapped trie.
+ *
+ * Immutable <key,value> map, every enter returns a new map sharing all
+ * untouched nodes with the old one, so keeping an old map costs O(1).
+ * Each level consumes 5 bits of the key hash. NULL is the empty map.
+ */
+typedef struct HMT_node_ *HMT_map;
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/**
+ * @brief Empty map constructor.
+ *
+ * @return HMT_map
+ */
+HMT_map HMT_empty(void);
+
+/**
+ * @brief Enter a key-value pair, O(log32 n).
+ *
+ * Existing key is replaced in the new map, old map is not changed.
+ * Nodes are alloced in current region.
+ *
+ * @param[in] map
+ * @param[in] hash  Key hash.
+ * @param[in] key   Not null, compared by address.
+ * @param[in] value
+ * @return HMT_map  New map.
+ */
+HMT_map HMT_enter(HMT_map map, unsigned hash, void *key, void *value);
+
+/**
+ * @brief Look(find) a key in map, O(log32 n).
+ *
+ * @param[in] map
+ * @param[in] hash  Key hash.
+ * @param[in] key
+ * @return void*    Value, NULL if not found.
+ */
+void *HMT_look(HMT_map map, unsigned hash, void *key);
+
+/**
+ * @brief Count pairs in map.
+ *
+ * @param[in] map
+ * @return int
+ */
+int HMT_size(HMT_map map);
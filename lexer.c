@@ -0,0 +1,472 @@
+/****************************************************************************
+ * Includes
+ ****************************************************************************/
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "ast.h"
+#include "context.h"
+#include "lexer.h"
+#include "symbol.h"
+#include "util.h"
+#include "y.tab.h"
+
+/****************************************************************************
+ * Definitions
+ ****************************************************************************/
+
+#define RETURN(x) \
+    ({ l->cur = cur; l->len = len; *lloc = tok - l->text; return x; })
+
+#define LEX_KEYWORDS    32  /*< perfect hash slots */
+
+typedef struct LEX_keyword_ LEX_keyword;
+
+struct LEX_keyword_
+{
+    const char *name;
+    int         len;
+    int         token;
+};
+
+/**
+ * @brief Lexer state of a context.
+ */
+typedef struct LEX_state_
+{
+    LEX_kind        kind;
+    TOK_array       feed;       /*< tokens served instead of lexing */
+    TOK_pipe        pipe;       /*< tokens served by lexer thread */
+    void *          scanner;    /*< flex scanner */
+    SRC_source      source;
+    const char *    text;       /*< source text, positions are relative */
+    const char *    cur;        /*< scanning position */
+    const char *    end;        /*< end of text, 2 nulls follow */
+    int             len;        /*< last token length */
+} LEX_state;
+
+int yylex(YYSTYPE *lval, YYLTYPE *lloc, void *scanner);
+int yylength(void *scanner);
+void *yyopen(SRC_source src);
+void yyclose(void *scanner);
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+/**
+ * @brief Keywords by perfect hash, see LEX_hash().
+ */
+static const LEX_keyword keywords[LEX_KEYWORDS] =
+{
+    [ 0] = { "else", 4, ELSE },
+    [ 2] = { "var", 3, VAR },
+    [ 5] = { "in", 2, IN },
+    [ 8] = { "function", 8, FUNCTION },
+    [ 9] = { "end", 3, END },
+    [10] = { "then", 4, THEN },
+    [11] = { "do", 2, DO },
+    [12] = { "nil", 3, NIL },
+    [13] = { "type", 4, TYPE },
+    [14] = { "let", 3, LET },
+    [15] = { "of", 2, OF },
+    [18] = { "for", 3, FOR },
+    [23] = { "break", 5, BREAK },
+    [24] = { "while", 5, WHILE },
+    [26] = { "array", 5, ARRAY },
+    [27] = { "to", 2, TO },
+    [29] = { "if", 2, IF },
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/**
+ * @brief State of current context.
+ */
+static inline LEX_state *LEX_cur(void)
+{
+    TIGER_ctx ctx = TIGER_cur();
+
+    if (__builtin_expect(!ctx->lex, 0))
+        ctx->lex = TIGER_mk_state(sizeof(*ctx->lex));
+
+    return ctx->lex;
+}
+
+/**
+ * @brief Keyword perfect hash, no collision among the 17 keywords.
+ */
+static inline unsigned LEX_hash(const char *s, int n)
+{
+    return ((unsigned char)s[0] * 3 + (unsigned char)s[n - 1] * 21 + n * 2)
+           & (LEX_KEYWORDS - 1);
+}
+
+#ifdef __SSE2__
+
+/* Loads are 16-byte aligned so they never cross a page, bytes before the
+ * scanning position are masked off. Every scan stops at the null behind
+ * the text at the latest.
+ */
+
+static inline const char *LEX_block(const char *p, unsigned *skip)
+{
+    const char *b = (const char *)((uintptr_t)p & ~(uintptr_t)15);
+
+    *skip = p - b;
+    return b;
+}
+
+static inline __m128i LEX_in(__m128i v, char lo, char hi)
+{
+    return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(lo - 1)),
+                         _mm_cmplt_epi8(v, _mm_set1_epi8(hi + 1)));
+}
+
+/**
+ * @brief Skip [ \t\r\n]*.
+ */
+static const char *LEX_skip_space(const char *p)
+{
+    unsigned skip, bits;
+    const char *b = LEX_block(p, &skip);
+    __m128i v, m;
+
+    for (;; b += 16, skip = 0) {
+        v = _mm_load_si128((const __m128i *)b);
+        m = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                             _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))),
+                _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\t')),
+                             _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'))));
+        bits = ~_mm_movemask_epi8(m) & (0xffffu << skip) & 0xffffu;
+        if (bits)
+            return b + __builtin_ctz(bits);
+    }
+}
+
+/**
+ * @brief Skip [a-zA-Z0-9_]*.
+ */
+static const char *LEX_skip_id(const char *p)
+{
+    unsigned skip, bits;
+    const char *b = LEX_block(p, &skip);
+    __m128i v, m;
+
+    for (;; b += 16, skip = 0) {
+        v = _mm_load_si128((const __m128i *)b);
+        m = _mm_or_si128(
+                _mm_or_si128(LEX_in(v, 'a', 'z'), LEX_in(v, 'A', 'Z')),
+                _mm_or_si128(LEX_in(v, '0', '9'),
+                             _mm_cmpeq_epi8(v, _mm_set1_epi8('_'))));
+        bits = ~_mm_movemask_epi8(m) & (0xffffu << skip) & 0xffffu;
+        if (bits)
+            return b + __builtin_ctz(bits);
+    }
+}
+
+/**
+ * @brief Skip comment body till next '/', '*' or null.
+ */
+static const char *LEX_skip_comment(const char *p)
+{
+    unsigned skip, bits;
+    const char *b = LEX_block(p, &skip);
+    __m128i v, m;
+
+    for (;; b += 16, skip = 0) {
+        v = _mm_load_si128((const __m128i *)b);
+        m = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('/')),
+                             _mm_cmpeq_epi8(v, _mm_set1_epi8('*'))),
+                _mm_cmpeq_epi8(v, _mm_setzero_si128()));
+        bits = _mm_movemask_epi8(m) & (0xffffu << skip) & 0xffffu;
+        if (bits)
+            return b + __builtin_ctz(bits);
+    }
+}
+
+#else
+
+static inline int LEX_is_id(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+           (c >= '0' && c <= '9') || c == '_';
+}
+
+static const char *LEX_skip_space(const char *p)
+{
+    while (*p == ' ' || *p == '\n' || *p == '\t' || *p == '\r')
+        p++;
+
+    return p;
+}
+
+static const char *LEX_skip_id(const char *p)
+{
+    while (LEX_is_id(*p))
+        p++;
+
+    return p;
+}
+
+static const char *LEX_skip_comment(const char *p)
+{
+    while (*p && *p != '/' && *p != '*')
+        p++;
+
+    return p;
+}
+
+#endif
+
+/**
+ * @brief Record newlines in [p, q).
+ *
+ * Only called on skipped whitespace, comments and strings.
+ */
+static void LEX_lines(LEX_state *l, const char *p, const char *q)
+{
+    while ((p = memchr(p, '\n', q - p))) {
+        SRC_newline(l->source, p - l->text);
+        p++;
+    }
+}
+
+/**
+ * @brief Skip nested comment, cur is behind its "/ *".
+ *
+ * Same as flex COMMENT state: "/ *" and "* /" are matched before single
+ * characters. Unterminated comment runs to end of text.
+ *
+ * @return const char*  Position behind the comment.
+ */
+static const char *LEX_comment(LEX_state *l, const char *cur)
+{
+    const char *from = cur;
+    int layer = 1;
+
+    while (layer > 0) {
+        cur = LEX_skip_comment(cur);
+        if (cur >= l->end)
+            break;
+
+        if (cur[0] == '/' && cur[1] == '*') {
+            layer++;
+            cur += 2;
+        } else if (cur[0] == '*' && cur[1] == '/') {
+            layer--;
+            cur += 2;
+        } else {
+            cur++;
+        }
+    }
+
+    LEX_lines(l, from, cur);
+    return cur;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+void LEX_use(LEX_kind kind)
+{
+    LEX_cur()->kind = kind;
+}
+
+void LEX_source(SRC_source src)
+{
+    LEX_state *l = LEX_cur();
+
+    if (l->scanner)
+        yyclose(l->scanner);
+
+    l->scanner = NULL;
+    l->source  = src;
+    l->text    = src ? SRC_text(src) : NULL;
+    l->cur     = l->text;
+    l->end     = src ? l->text + SRC_size(src) : NULL;
+
+    if (src && l->kind == LEX_kind_flex)
+        l->scanner = yyopen(src);
+}
+
+void LEX_feed(TOK_array tokens)
+{
+    LEX_cur()->feed = tokens;
+}
+
+void LEX_pipe(TOK_pipe pipe)
+{
+    LEX_cur()->pipe = pipe;
+}
+
+void LEX_abort(void)
+{
+    LEX_state *l = LEX_cur();
+
+    if (l->pipe)
+        TOK_stop(l->pipe);
+    if (l->feed)
+        TOK_free(l->feed);
+
+    l->pipe = NULL;
+    l->feed = NULL;
+    LEX_source(NULL);
+}
+
+int LEX_next(YYSTYPE *lval, YYLTYPE *lloc)
+{
+    LEX_state *l = LEX_cur();
+    int kind;
+
+    for (;;) {
+        if (l->feed)
+            kind = TOK_next(l->feed, lval, lloc);
+        else if (l->pipe)
+            kind = TOK_pull(l->pipe, lval, lloc);
+        else
+            kind = LEX_scan(lval, lloc);
+
+        if (kind != LEX_BAD)
+            return kind;
+
+        UTL_diag(*lloc, "lex, illegal character(%c)", lval->ival);
+    }
+}
+
+int LEX_scan(YYSTYPE *lval, YYLTYPE *lloc)
+{
+    LEX_state *l = LEX_cur();
+
+    if (l->kind == LEX_kind_hand)
+        return LEX_lex(lval, lloc);
+
+    return yylex(lval, lloc, l->scanner);
+}
+
+int LEX_length(void)
+{
+    LEX_state *l = LEX_cur();
+
+    return l->kind == LEX_kind_hand ? l->len : yylength(l->scanner);
+}
+
+int LEX_lex(YYSTYPE *lval, YYLTYPE *lloc)
+{
+    LEX_state *l = LEX_cur();
+    const char *cur = l->cur, *tok, *p;
+    const LEX_keyword *k;
+    int len;
+
+    for (;;) {
+        p   = cur;
+        cur = LEX_skip_space(cur);
+        LEX_lines(l, p, cur);
+        tok = cur;
+        len = 1;
+
+        if (cur >= l->end)
+            RETURN(0);
+
+        switch (*cur++) {
+            case '/':
+                if (*cur == '*') {
+                    cur = LEX_comment(l, cur + 1);
+                    continue;
+                }
+                RETURN(DIVIDE);
+
+            case ',': RETURN(COMMA);
+            case ';': RETURN(SEMICOLON);
+            case '(': RETURN(LP);
+            case ')': RETURN(RP);
+            case '[': RETURN(LK);
+            case ']': RETURN(RK);
+            case '{': RETURN(LC);
+            case '}': RETURN(RC);
+            case '.': RETURN(DOT);
+            case '+': RETURN(PLUS);
+            case '-': RETURN(MINUS);
+            case '*': RETURN(TIMES);
+            case '=': RETURN(EQ);
+            case '&': RETURN(AND);
+            case '|': RETURN(OR);
+
+            case ':':
+                if (*cur == '=') {
+                    cur++, len++;
+                    RETURN(ASSIGN);
+                }
+                RETURN(COLON);
+
+            case '<':
+                if (*cur == '>') {
+                    cur++, len++;
+                    RETURN(NEQ);
+                } else if (*cur == '=') {
+                    cur++, len++;
+                    RETURN(LE);
+                }
+                RETURN(LT);
+
+            case '>':
+                if (*cur == '=') {
+                    cur++, len++;
+                    RETURN(GE);
+                }
+                RETURN(GT);
+
+            case '"':
+                p = memchr(cur, '"', l->end - cur);
+                if (!p)
+                    break;
+                cur = p + 1;
+                len = cur - tok;
+                LEX_lines(l, tok, cur);
+                lval->sval = UTL_strpool(tok, len);
+                RETURN(STRING);
+
+            case '0' ... '9': {
+                // as atoi() of flex: strtol() saturates, int keeps low bits.
+                unsigned long v = *tok - '0';
+                int d;
+
+                while (*cur >= '0' && *cur <= '9') {
+                    d = *cur++ - '0';
+                    v = v > (unsigned long)(LONG_MAX - d) / 10 ? LONG_MAX
+                                                               : v * 10 + d;
+                }
+                lval->ival = (int)(long)v;
+                len = cur - tok;
+                RETURN(INT);
+            }
+
+            case 'a' ... 'z':
+            case 'A' ... 'Z':
+                cur = LEX_skip_id(cur);
+                len = cur - tok;
+                k   = &keywords[LEX_hash(tok, len)];
+                if (k->len == len && !memcmp(k->name, tok, len))
+                    RETURN(k->token);
+                lval->sym = SYM_declare_n(tok, len);
+                RETURN(ID);
+
+            default:
+                break;
+        }
+
+        lval->ival = (unsigned char)*tok;
+        RETURN(LEX_BAD);
+    }
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+/****************************************************************************
+ * Includes
+ ****************************************************************************/
+
+#include "ast.h"
+#include "source.h"
+#include "token.h"
+
+/****************************************************************************
+ * Definitions
+ ****************************************************************************/
+
+union YYSTYPE;   /*< semantic value, see y.tab.h */
+
+#define LEX_BAD     (-1)    /*< illegal character token, ival holds it */
+
+/**
+ * @brief Lexer implementations, both give the same token stream.
+ */
+typedef enum {
+    LEX_kind_flex,  /*< generated from tiger.lex */
+    LEX_kind_hand,  /*< hand-written, SIMD skipping */
+} LEX_kind;
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/* Lexer state lives in current context, see TIGER_use(). */
+
+/**
+ * @brief Select lexer used by LEX_next(), flex by default.
+ *
+ * @param[in] kind
+ */
+void LEX_use(LEX_kind kind);
+
+/**
+ * @brief Start scanning source, or stop if src is NULL.
+ *
+ * @param[in] src
+ */
+void LEX_source(SRC_source src);
+
+/**
+ * @brief Serve tokens from a pre-lexed array, or stop if tokens is NULL.
+ *
+ * While feeding, LEX_next() reads the array and no lexer runs.
+ *
+ * @param[in] tokens
+ */
+void LEX_feed(TOK_array tokens);
+
+/**
+ * @brief Serve tokens from a lexer thread, or stop if pipe is NULL.
+ *
+ * @param[in] pipe
+ */
+void LEX_pipe(TOK_pipe pipe);
+
+/**
+ * @brief Drop whatever serves tokens, for an error that skipped its owner.
+ *
+ * A pipe is stopped, its lexer thread joined, a fed array freed and the
+ * scanner closed.
+ */
+void LEX_abort(void);
+
+/**
+ * @brief Next token of selected lexer, or of fed array or pipe.
+ *
+ * Same contract as a pure yylex(): token in return value, semantic value
+ * and position through pointers, 0 at end of source. LEX_BAD tokens are
+ * reported here and skipped, so errors come in source order in any mode.
+ *
+ * @param[out] lval
+ * @param[out] lloc
+ * @return int  Token.
+ */
+int LEX_next(union YYSTYPE *lval, Apos *lloc);
+
+/**
+ * @brief Next token of selected lexer, ignoring any feed.
+ *
+ * @param[out] lval
+ * @param[out] lloc
+ * @return int  Token.
+ */
+int LEX_scan(union YYSTYPE *lval, Apos *lloc);
+
+/**
+ * @brief Length of the token last returned by selected lexer.
+ *
+ * @return int
+ */
+int LEX_length(void);
+
+/**
+ * @brief Next token of hand-written lexer.
+ *
+ * @param[out] lval
+ * @param[out] lloc
+ * @return int  Token.
+ */
+int LEX_lex(union YYSTYPE *lval, Apos *lloc);
@@ -0,0 +1,576 @@
+/****************************************************************************
+ * Includes
+ ****************************************************************************/
+
+#include <stdbool.h>
+#include <stdio.h>
+#include "ast.h"
+#include "lexer.h"
+#include "parser.h"
+#include "symbol.h"
+#include "util.h"
+#include "y.tab.h"
+
+/****************************************************************************
+ * Definitions
+ ****************************************************************************/
+
+/* Binding powers, a binary operator takes operands binding tighter than
+ * itself. Unary minus takes only a primary, like %prec UMINUS.
+ */
+#define PAR_PREC_NONE       0
+#define PAR_PREC_LOGIC      1   /*< & |, left */
+#define PAR_PREC_COMPARE    2   /*< = <> < <= > >=, non-associative */
+#define PAR_PREC_ADD        3   /*< + -, left */
+#define PAR_PREC_MUL        4   /*< * /, left */
+
+/**
+ * @brief Parser of one source, lives on the stack of PAR_parse().
+ */
+typedef struct PAR_parser_
+{
+    int         tok;    /*< current token */
+    YYSTYPE     val;    /*< its semantic value */
+    Apos        pos;    /*< its position */
+    int         errors;
+    bool        quiet;  /*< error reported, silent until a token matches */
+} PAR_parser;
+
+static AST_exp PAR_exp(PAR_parser *p, int prec);
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/**
+ * @brief Token as shown in error messages.
+ */
+static const char *PAR_name(int tok)
+{
+    switch (tok) {
+        case 0:         return "end of file";
+        case INT:       return "integer";
+        case ID:        return "identifier";
+        case STRING:    return "string";
+        case COMMA:     return "','";
+        case COLON:     return "':'";
+        case SEMICOLON: return "';'";
+        case LP:        return "'('";
+        case RP:        return "')'";
+        case LK:        return "'['";
+        case RK:        return "']'";
+        case LC:        return "'{'";
+        case RC:        return "'}'";
+        case DOT:       return "'.'";
+        case PLUS:      return "'+'";
+        case MINUS:     return "'-'";
+        case TIMES:     return "'*'";
+        case DIVIDE:    return "'/'";
+        case EQ:        return "'='";
+        case NEQ:       return "'<>'";
+        case LT:        return "'<'";
+        case LE:        return "'<='";
+        case GT:        return "'>'";
+        case GE:        return "'>='";
+        case AND:       return "'&'";
+        case OR:        return "'|'";
+        case ASSIGN:    return "':='";
+        case ARRAY:     return "'array'";
+        case IF:        return "'if'";
+        case THEN:      return "'then'";
+        case ELSE:      return "'else'";
+        case WHILE:     return "'while'";
+        case FOR:       return "'for'";
+        case TO:        return "'to'";
+        case DO:        return "'do'";
+        case LET:       return "'let'";
+        case IN:        return "'in'";
+        case END:       return "'end'";
+        case OF:        return "'of'";
+        case BREAK:     return "'break'";
+        case NIL:       return "'nil'";
+        case FUNCTION:  return "'function'";
+        case VAR:       return "'var'";
+        case TYPE:      return "'type'";
+        default:        return "unknown token";
+    }
+}
+
+static inline void PAR_next(PAR_parser *p)
+{
+    p->tok = LEX_next(&p->val, &p->pos);
+}
+
+/**
+ * @brief Report error at current token, unless one is pending.
+ */
+static void PAR_error(PAR_parser *p, const char *msg)
+{
+    if (p->quiet)
+        return;
+
+    p->errors++;
+    p->quiet = true;
+    UTL_diag(p->pos, "parse, %s, found %s", msg, PAR_name(p->tok));
+}
+
+static void PAR_expected(PAR_parser *p, const char *what)
+{
+    char msg[64];
+
+    snprintf(msg, sizeof(msg), "expected %s", what);
+    PAR_error(p, msg);
+}
+
+static bool PAR_accept(PAR_parser *p, int tok)
+{
+    if (p->tok != tok)
+        return false;
+
+    PAR_next(p);
+    p->quiet = false;
+    return true;
+}
+
+static bool PAR_expect(PAR_parser *p, int tok)
+{
+    if (PAR_accept(p, tok))
+        return true;
+
+    PAR_expected(p, PAR_name(tok));
+    return false;
+}
+
+/**
+ * @brief Expect tok, on error skip to it unless stop or end comes first.
+ */
+static void PAR_skip_to(PAR_parser *p, int tok, int stop)
+{
+    if (PAR_expect(p, tok))
+        return;
+
+    while (p->tok && p->tok != tok && p->tok != stop)
+        PAR_next(p);
+    PAR_accept(p, tok);
+}
+
+static SYM_symbol PAR_id(PAR_parser *p)
+{
+    SYM_symbol sym = p->val.sym;
+
+    if (PAR_expect(p, ID))
+        return sym;
+
+    return NULL;
+}
+
+/**
+ * @brief Tokens an enclosing rule may resume at, never skipped on error.
+ */
+static bool PAR_is_sync(int tok)
+{
+    switch (tok) {
+        case 0:
+        case COMMA: case SEMICOLON: case RP: case RK: case RC:
+        case THEN: case ELSE: case DO: case TO: case OF: case IN: case END:
+        case VAR: case TYPE: case FUNCTION:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief Skip tokens up to one an enclosing rule may resume at.
+ */
+static void PAR_sync(PAR_parser *p)
+{
+    while (!PAR_is_sync(p->tok))
+        PAR_next(p);
+}
+
+/**
+ * @brief Binding power of binary operator, PAR_PREC_NONE if tok is not one.
+ */
+static int PAR_prec(int tok)
+{
+    switch (tok) {
+        case AND: case OR:
+            return PAR_PREC_LOGIC;
+        case EQ: case NEQ: case LT: case LE: case GT: case GE:
+            return PAR_PREC_COMPARE;
+        case PLUS: case MINUS:
+            return PAR_PREC_ADD;
+        case TIMES: case DIVIDE:
+            return PAR_PREC_MUL;
+        default:
+            return PAR_PREC_NONE;
+    }
+}
+
+static AST_kind_op PAR_op(int tok)
+{
+    switch (tok) {
+        case PLUS:   return AST_kind_op_plus;
+        case MINUS:  return AST_kind_op_minus;
+        case TIMES:  return AST_kind_op_times;
+        case DIVIDE: return AST_kind_op_divide;
+        case EQ:     return AST_kind_op_eq;
+        case NEQ:    return AST_kind_op_neq;
+        case LT:     return AST_kind_op_lt;
+        case LE:     return AST_kind_op_le;
+        case GT:     return AST_kind_op_gt;
+        default:     return AST_kind_op_ge;
+    }
+}
+
+/****************************************************************************
+ * Private Functions: list
+ ****************************************************************************/
+
+/* Lists are built front to back by pushing each element, they come out the
+ * same as the yacc rules.
+ */
+
+/**
+ * @brief exp (sep exp)*
+ */
+static AST_exp_list PAR_exps(PAR_parser *p, int sep)
+{
+    AST_exp_list list = NULL;
+
+    for (;;) {
+        list = AST_push_exp(list, PAR_exp(p, PAR_PREC_NONE));
+
+        if (PAR_accept(p, sep))
+            continue;
+        if (PAR_is_sync(p->tok))
+            return list;
+
+        // junk behind an element, resume at next separator.
+        PAR_expected(p, PAR_name(sep));
+        PAR_sync(p);
+        if (!PAR_accept(p, sep))
+            return list;
+    }
+}
+
+/**
+ * @brief id : id (, id : id)*
+ */
+static AST_para_list PAR_paras(PAR_parser *p)
+{
+    AST_para_list list = NULL;
+    SYM_symbol name;
+    Apos pos;
+
+    do {
+        pos  = p->pos;
+        name = PAR_id(p);
+        PAR_expect(p, COLON);
+        list = AST_push_para(list, AST_mk_para(pos, name, PAR_id(p)));
+    } while (PAR_accept(p, COMMA));
+
+    return list;
+}
+
+/**
+ * @brief id = exp (, id = exp)*
+ */
+static AST_arg_list PAR_args(PAR_parser *p)
+{
+    AST_arg_list list = NULL;
+    SYM_symbol name;
+
+    do {
+        name = PAR_id(p);
+        PAR_expect(p, EQ);
+        list = AST_push_arg(list, AST_mk_arg(name, PAR_exp(p, PAR_PREC_NONE)));
+    } while (PAR_accept(p, COMMA));
+
+    return list;
+}
+
+/****************************************************************************
+ * Private Functions: declares
+ ****************************************************************************/
+
+static AST_type PAR_type(PAR_parser *p)
+{
+    AST_para_list fields = NULL;
+    Apos pos = p->pos;
+
+    if (PAR_accept(p, ARRAY)) {
+        PAR_expect(p, OF);
+        return AST_mk_type_array(pos, PAR_id(p));
+    }
+
+    if (PAR_accept(p, LC)) {
+        if (p->tok != RC)
+            fields = PAR_paras(p);
+        PAR_expect(p, RC);
+        return AST_mk_type_record(pos, fields);
+    }
+
+    return AST_mk_type_name(pos, PAR_id(p));
+}
+
+static AST_dec PAR_dec(PAR_parser *p)
+{
+    AST_para_list paras = NULL;
+    SYM_symbol name, type = NULL;
+    Apos pos = p->pos;
+
+    switch (p->tok) {
+        case VAR:
+            PAR_next(p);
+            name = PAR_id(p);
+            if (PAR_accept(p, COLON))
+                type = PAR_id(p);
+            PAR_expect(p, ASSIGN);
+            return AST_mk_dec_var(pos, name, type, PAR_exp(p, PAR_PREC_NONE));
+
+        case TYPE:
+            PAR_next(p);
+            name = PAR_id(p);
+            PAR_expect(p, EQ);
+            return AST_mk_dec_type(pos, name, PAR_type(p));
+
+        default:
+            PAR_next(p);
+            name = PAR_id(p);
+            PAR_expect(p, LP);
+            if (p->tok != RP)
+                paras = PAR_paras(p);
+            PAR_expect(p, RP);
+            if (PAR_accept(p, COLON))
+                type = PAR_id(p);
+            PAR_expect(p, EQ);
+            return AST_mk_dec_func(pos, name, paras, type,
+                                   PAR_exp(p, PAR_PREC_NONE));
+    }
+}
+
+static AST_dec_list PAR_decs(PAR_parser *p)
+{
+    AST_dec_list list = NULL;
+
+    while (p->tok == VAR || p->tok == TYPE || p->tok == FUNCTION)
+        list = AST_push_dec(list, PAR_dec(p));
+
+    return list;
+}
+
+/****************************************************************************
+ * Private Functions: expressions
+ ****************************************************************************/
+
+/**
+ * @brief ([exp] | .id)*
+ *
+ * Built from the back as the yacc rule, a node is complete once made, see
+ * AST_share().
+ */
+static AST_var PAR_suffix(PAR_parser *p)
+{
+    Apos at = p->pos;
+    SYM_symbol name;
+    AST_exp exp;
+
+    if (PAR_accept(p, LK)) {
+        exp = PAR_exp(p, PAR_PREC_NONE);
+        PAR_expect(p, RK);
+        return AST_mk_var_index(at, exp, PAR_suffix(p));
+    }
+
+    if (PAR_accept(p, DOT)) {
+        name = PAR_id(p);
+        return AST_mk_var_field(at, name, PAR_suffix(p));
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Expression led by an identifier: call, record, array or lvalue.
+ */
+static AST_exp PAR_id_exp(PAR_parser *p)
+{
+    SYM_symbol name = p->val.sym;
+    AST_exp_list exps = NULL;
+    AST_arg_list args = NULL;
+    AST_var suffix, var;
+    AST_exp exp;
+    Apos pos = p->pos, at;
+
+    PAR_next(p);
+
+    if (PAR_accept(p, LP)) {
+        if (p->tok != RP)
+            exps = PAR_exps(p, COMMA);
+        PAR_expect(p, RP);
+        return AST_mk_exp_call(pos, name, exps);
+    }
+
+    if (PAR_accept(p, LC)) {
+        if (p->tok != RC)
+            args = PAR_args(p);
+        PAR_expect(p, RC);
+        return AST_mk_exp_record(pos, name, args);
+    }
+
+    // id [exp] is an array creation if "of" follows, else an index.
+    if (p->tok == LK) {
+        at = p->pos;
+        PAR_next(p);
+        exp = PAR_exp(p, PAR_PREC_NONE);
+        PAR_expect(p, RK);
+        if (PAR_accept(p, OF))
+            return AST_mk_exp_array(pos, name, exp, PAR_exp(p, PAR_PREC_NONE));
+        suffix = AST_mk_var_index(at, exp, PAR_suffix(p));
+    } else {
+        suffix = PAR_suffix(p);
+    }
+
+    var = AST_mk_var_base(pos, name, suffix);
+
+    at = p->pos;
+    if (PAR_accept(p, ASSIGN))
+        return AST_mk_exp_assign(at, var, PAR_exp(p, PAR_PREC_NONE));
+
+    return AST_mk_exp_var(pos, var);
+}
+
+/**
+ * @brief Expression not led by an operand, a trailing exp takes all it can
+ *        like yacc shifting on conflicts.
+ */
+static AST_exp PAR_primary(PAR_parser *p)
+{
+    AST_exp_list list = NULL;
+    AST_dec_list decs;
+    AST_exp a, b, c;
+    SYM_symbol var;
+    Apos pos = p->pos;
+
+    switch (p->tok) {
+        case NIL:
+            PAR_accept(p, NIL);
+            return AST_mk_exp_nil(pos);
+
+        case INT:
+            a = AST_mk_exp_int(pos, p->val.ival);
+            PAR_accept(p, INT);
+            return a;
+
+        case STRING:
+            a = AST_mk_exp_str(pos, p->val.sval);
+            PAR_accept(p, STRING);
+            return a;
+
+        case ID:
+            return PAR_id_exp(p);
+
+        case MINUS:
+            PAR_accept(p, MINUS);
+            a = PAR_exp(p, PAR_PREC_MUL);
+            return AST_mk_exp_op(pos, AST_kind_op_minus,
+                                 AST_mk_exp_int(pos, 0), a);
+
+        case LP:
+            PAR_accept(p, LP);
+            if (p->tok != RP)
+                list = PAR_exps(p, SEMICOLON);
+            PAR_expect(p, RP);
+            return AST_mk_exp_seq(pos, list);
+
+        case IF:
+            PAR_accept(p, IF);
+            a = PAR_exp(p, PAR_PREC_NONE);
+            PAR_expect(p, THEN);
+            b = PAR_exp(p, PAR_PREC_NONE);
+            c = PAR_accept(p, ELSE) ? PAR_exp(p, PAR_PREC_NONE) : NULL;
+            return AST_mk_exp_if(pos, a, b, c);
+
+        case WHILE:
+            PAR_accept(p, WHILE);
+            a = PAR_exp(p, PAR_PREC_NONE);
+            PAR_expect(p, DO);
+            return AST_mk_exp_while(pos, a, PAR_exp(p, PAR_PREC_NONE));
+
+        case FOR:
+            PAR_accept(p, FOR);
+            var = PAR_id(p);
+            PAR_expect(p, ASSIGN);
+            a = PAR_exp(p, PAR_PREC_NONE);
+            PAR_expect(p, TO);
+            b = PAR_exp(p, PAR_PREC_NONE);
+            PAR_expect(p, DO);
+            return AST_mk_exp_for(pos, var, a, b, PAR_exp(p, PAR_PREC_NONE));
+
+        case BREAK:
+            PAR_accept(p, BREAK);
+            return AST_mk_exp_break(pos);
+
+        case LET:
+            PAR_accept(p, LET);
+            decs = PAR_decs(p);
+            PAR_skip_to(p, IN, END);
+            if (p->tok != END)
+                list = PAR_exps(p, SEMICOLON);
+            PAR_expect(p, END);
+            return AST_mk_exp_let(pos, decs, list);
+
+        default:
+            PAR_expected(p, "expression");
+            PAR_sync(p);
+            return NULL;
+    }
+}
+
+/**
+ * @brief Expression of operators binding tighter than prec.
+ */
+static AST_exp PAR_exp(PAR_parser *p, int prec)
+{
+    AST_exp left = PAR_primary(p), right;
+    int tok, op, last = PAR_PREC_NONE;
+    Apos pos;
+
+    while ((op = PAR_prec(p->tok)) > prec) {
+        if (op == PAR_PREC_COMPARE && last == PAR_PREC_COMPARE)
+            PAR_error(p, "comparisons do not chain");
+
+        tok = p->tok;
+        pos = p->pos;
+        PAR_accept(p, tok);
+        right = PAR_exp(p, op);
+        last  = op;
+
+        if (tok == AND)
+            left = AST_mk_exp_if(pos, left, right, AST_mk_exp_int(pos, 0));
+        else if (tok == OR)
+            left = AST_mk_exp_if(pos, left, AST_mk_exp_int(pos, 1), right);
+        else
+            left = AST_mk_exp_op(pos, PAR_op(tok), left, right);
+    }
+
+    return left;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int PAR_parse(SRC_source src, AST_exp *root)
+{
+    PAR_parser p = { 0 };
+    int errors = UTL_errors();
+
+    PAR_next(&p);
+    *root = PAR_exp(&p, PAR_PREC_NONE);
+    PAR_expect(&p, 0);
+
+    // lexer reports illegal characters itself, count them as parse().
+    return p.errors || UTL_errors() != errors;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+/****************************************************************************
+ * Includes
+ ****************************************************************************/
+
+#include "ast.h"
+#include "source.h"
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/**
+ * @brief Parse source with the hand-written parser.
+ *
+ * Recursive descent, with binding powers for binary operators. Builds the
+ * same tree as the yacc parser, and takes tokens from LEX_next() the same
+ * way, caller sets up lexer, array or pipe.
+ *
+ * Errors are reported by UTL_diag() as "expected ..., found ...", parser
+ * resumes at the next separator or closing token so one run reports all.
+ *
+ * @param[in] src       Source being parsed, same as for parse().
+ * @param[out] root     Whole program.
+ * @return int  0 on success, non-zero on parse or lexical errors.
+ */
+int PAR_parse(SRC_source src, AST_exp *root);
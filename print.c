@@ -2,10 +2,15 @@
  * Include Files
  ****************************************************************************/
 
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
 #include "ast.h"
+#include "flat.h"
 #include "symbol.h"
 #include "type.h"
 #include "util.h"
+#include "visit.h"
 
 /****************************************************************************
  * Definitions
@@ -40,282 +45,1245 @@ static const char *str_type[] =
     "record",
 };
 
+/****************************************************************************
+ * Private: ast output
+ ****************************************************************************/
+
+#define AST_DUMP_SIZE   (1 << 20)   /*< output buffer bytes */
+#define AST_DUMP_LEVELS 64          /*< indent levels written at once */
+
+#define DOTS4   ".   .   .   .   "
+#define DOTS16  DOTS4 DOTS4 DOTS4 DOTS4
+
+/* WHITE() of AST_DUMP_LEVELS - 1 */
+static const char dots[] = DOTS16 DOTS16 DOTS16 DOTS16;
+
+/**
+ * @brief Buffered output of a dump, to a file or a file descriptor.
+ */
+typedef struct AST_pr_out_
+{
+    AST_dump_format format;
+    char *          buf;
+    size_t          n;
+    FILE *          file;   /*< NULL when writing to fd */
+    int             fd;
+    bool            failed; /*< rest of dump is dropped */
+} AST_pr_out;
+
+static void AST_pr_flush(AST_pr_out *o)
+{
+    const char *p = o->buf;
+    size_t      n = o->n;
+    ssize_t     k;
+
+    o->n = 0;
+    if (o->failed)
+        return;
+
+    if (o->file) {
+        o->failed = fwrite(p, 1, n, o->file) != n;
+        return;
+    }
+
+    while (n > 0) {
+        k = write(o->fd, p, n);
+        if (k < 0 && errno == EINTR)
+            continue;
+        if (k <= 0) {
+            o->failed = true;
+            return;
+        }
+        p += k;
+        n -= k;
+    }
+}
+
+/* put past end of buffer, in buffer-sized pieces. */
+static void AST_pr_spill(AST_pr_out *o, const char *s, size_t len)
+{
+    size_t room;
+
+    while (len > (room = AST_DUMP_SIZE - o->n)) {
+        memcpy(o->buf + o->n, s, room);
+        o->n += room;
+        s    += room;
+        len  -= room;
+        AST_pr_flush(o);
+    }
+    memcpy(o->buf + o->n, s, len);
+    o->n += len;
+}
+
+static inline void AST_pr_put(AST_pr_out *o, const char *s, size_t len)
+{
+    if (__builtin_expect(len > AST_DUMP_SIZE - o->n, 0)) {
+        AST_pr_spill(o, s, len);
+        return;
+    }
+    memcpy(o->buf + o->n, s, len);
+    o->n += len;
+}
+
+static inline void AST_pr_str(AST_pr_out *o, const char *s)
+{
+    AST_pr_put(o, s, strlen(s));
+}
+
+static inline void AST_pr_char(AST_pr_out *o, char c)
+{
+    if (o->n == AST_DUMP_SIZE)
+        AST_pr_flush(o);
+    o->buf[o->n++] = c;
+}
+
+static void AST_pr_int(AST_pr_out *o, int v)
+{
+    char     s[16], *p = s + sizeof(s);
+    unsigned u = v < 0 ? -(unsigned)v : (unsigned)v;
+
+    do {
+        *--p = '0' + u % 10;
+    } while (u /= 10);
+    if (v < 0)
+        *--p = '-';
+
+    AST_pr_put(o, p, s + sizeof(s) - p);
+}
+
+/* same as WHITE(d), levels past the dots are written in runs. */
+static void AST_pr_indent(AST_pr_out *o, int d)
+{
+    int levels = d + 1;
+
+    for (; levels > AST_DUMP_LEVELS; levels -= AST_DUMP_LEVELS)
+        AST_pr_put(o, dots, sizeof(dots) - 1);
+    AST_pr_put(o, dots, levels * 4);
+}
+
+/* indented "label:value" line. */
+static void AST_pr_attr(AST_pr_out *o, int d, const char *label,
+                        const char *value)
+{
+    AST_pr_indent(o, d);
+    AST_pr_str(o, label);
+    AST_pr_str(o, value);
+    AST_pr_char(o, '\n');
+}
+
+/* json string of s[0, len), quotes and control characters escaped. */
+static void AST_pr_json_str(AST_pr_out *o, const char *s, size_t len)
+{
+    static const char hex[] = "0123456789abcdef";
+    size_t i, from;
+
+    AST_pr_char(o, '"');
+    for (i = from = 0; i < len; i++) {
+        unsigned char c = s[i];
+
+        if (c >= 0x20 && c != '"' && c != '\\')
+            continue;
+
+        AST_pr_put(o, s + from, i - from);
+        from = i + 1;
+        AST_pr_char(o, '\\');
+        if (c == '"' || c == '\\') {
+            AST_pr_char(o, c);
+        } else {
+            AST_pr_put(o, "u00", 3);
+            AST_pr_char(o, hex[c >> 4]);
+            AST_pr_char(o, hex[c & 0xf]);
+        }
+    }
+    AST_pr_put(o, s + from, len - from);
+    AST_pr_char(o, '"');
+}
+
 /****************************************************************************
  * Private: ast display
  ****************************************************************************/
 
-static void AST_pr_dec(FILE *out, AST_dec n, int d);
-static void AST_pr_exp(FILE *out, AST_exp n, int d);
-static void AST_pr_var(FILE *out, AST_var n, int d);
-static void AST_pr_type(FILE *out, AST_type n, int d);
-static void AST_pr_dec_list(FILE *out, AST_dec_list n, int d);
-static void AST_pr_exp_list(FILE *out, AST_exp_list n, int d);
-static void AST_pr_para(FILE *out, AST_para n, int d);
-static void AST_pr_para_list(FILE *out, AST_para_list n, int d);
-static void AST_pr_arg(FILE *out, AST_arg n, int d);
-static void AST_pr_arg_list(FILE *out, AST_arg_list n, int d);
+/**
+ * @brief Locals of a node being printed.
+ */
+typedef struct AST_pr_local_
+{
+    int d;  /*< depth of its first line */
+} AST_pr_local;
+
+static const char *str_list[] =
+{
+    [VIS_exp_list]  = "exp_list",
+    [VIS_dec_list]  = "dec_list",
+    [VIS_para_list] = "para_list",
+    [VIS_arg_list]  = "arg_list",
+};
+
+static inline bool AST_pr_is_list(VIS_class c)
+{
+    return c >= VIS_exp_list;
+}
+
+static inline int AST_pr_len(VIS_frame *f)
+{
+    return AST_LEN((AST_exp_list)f->node);
+}
+
+static inline const char *AST_pr_bool(bool b)
+{
+    return b ? "true" : "false";
+}
 
-static inline void AST_pr_op(FILE *out, int oper)
+/* depth of node, element k of a list sits in its k-th cell. */
+static int AST_pr_depth(VIS_walk w)
 {
-    fprintf(out, "%s", str_op[oper]);
+    VIS_frame *up = VIS_up(w);
+    AST_pr_local *l;
+
+    if (!up)
+        return 0;
+
+    l = VIS_local(up);
+    return AST_pr_is_list(up->class) ? l->d + up->step + 1 : l->d + 1;
 }
 
-static void AST_pr_dec(FILE *out, AST_dec n, int d)
+/* head of node, up to its first child. */
+static void AST_pr_enter(AST_pr_out *o, VIS_frame *f, int d)
 {
+    if (AST_pr_is_list(f->class))
+        return;
+
+    AST_pr_indent(o, d);
+    switch (f->class) {
+        case VIS_dec: {
+            AST_dec n = f->node;
+
+            switch (n->kind) {
+                case AST_kind_dec_var:
+                    AST_pr_str(o, "dec_variable(\n");
+                    if (n->u.var.type)
+                        AST_pr_attr(o, d + 1, "type:",
+                                    SYM_get_name(n->u.var.type));
+                    break;
+
+                case AST_kind_dec_type:
+                    AST_pr_str(o, "dec_type(\n");
+                    AST_pr_attr(o, d + 1, "name:",
+                                SYM_get_name(n->u.type.name));
+                    break;
+
+                case AST_kind_dec_func:
+                    AST_pr_str(o, "dec_function(\n");
+                    AST_pr_attr(o, d + 1, "name:",
+                                SYM_get_name(n->u.func.name));
+                    break;
+
+                default:
+                    UTL_error(-1, "Unkown dec node");
+            }
+            break;
+        }
+
+        case VIS_exp: {
+            AST_exp n = f->node;
+
+            switch (n->kind) {
+                case AST_kind_exp_var:
+                    AST_pr_str(o, "exp_variable(\n");
+                    break;
+
+                case AST_kind_exp_nil:
+                    AST_pr_str(o, "exp_nil()\n");
+                    break;
+
+                case AST_kind_exp_int:
+                    AST_pr_str(o, "exp_integer(");
+                    AST_pr_int(o, n->u.int_);
+                    AST_pr_str(o, ")\n");
+                    break;
+
+                case AST_kind_exp_str:
+                    AST_pr_str(o, "exp_string(");
+                    AST_pr_str(o, n->u.str_);
+                    AST_pr_str(o, ")\n");
+                    break;
+
+                case AST_kind_exp_call:
+                    AST_pr_str(o, "exp_call(\n");
+                    AST_pr_attr(o, d + 1, "func:",
+                                SYM_get_name(n->u.call.func));
+                    break;
+
+                case AST_kind_exp_op:
+                    AST_pr_str(o, "exp_op(\n");
+                    AST_pr_attr(o, d + 1, "", str_op[n->u.op.oper]);
+                    break;
+
+                case AST_kind_exp_array:
+                    AST_pr_str(o, "exp_array(\n");
+                    AST_pr_attr(o, d + 1, "array:",
+                                SYM_get_name(n->u.array.type));
+                    break;
+
+                case AST_kind_exp_record:
+                    AST_pr_str(o, "exp_record(\n");
+                    break;
+
+                case AST_kind_exp_seq:
+                    AST_pr_str(o, "exp_sequence(\n");
+                    break;
+
+                case AST_kind_exp_assign:
+                    AST_pr_str(o, "exp_assign(\n");
+                    break;
+
+                case AST_kind_exp_if:
+                    AST_pr_str(o, "exp_if(\n");
+                    break;
+
+                case AST_kind_exp_while:
+                    AST_pr_str(o, "exp_while(\n");
+                    break;
+
+                case AST_kind_exp_for:
+                    AST_pr_str(o, "exp_for(\n");
+                    AST_pr_attr(o, d + 1, "var:",
+                                SYM_get_name(n->u.for_.var));
+                    break;
+
+                case AST_kind_exp_break:
+                    AST_pr_str(o, "exp_break(\n");
+                    break;
+
+                case AST_kind_exp_let:
+                    AST_pr_str(o, "exp_let(\n");
+                    break;
+
+                default:
+                    UTL_error(-1, "Unkown exp node");
+            }
+            break;
+        }
+
+        case VIS_var: {
+            AST_var n = f->node;
+
+            switch (n->kind) {
+                case AST_kind_var_base:
+                    AST_pr_str(o, "var_base(\n");
+                    AST_pr_attr(o, d + 1, "base:",
+                                SYM_get_name(n->u.base.name));
+                    break;
+
+                case AST_kind_var_index:
+                    AST_pr_str(o, "var_array_index(\n");
+                    break;
+
+                case AST_kind_var_field:
+                    AST_pr_str(o, "var_record_field(\n");
+                    AST_pr_attr(o, d + 1, "field:",
+                                SYM_get_name(n->u.field.name));
+                    break;
+
+                default:
+                    UTL_error(-1, "Unkown var node");
+            }
+            break;
+        }
+
+        case VIS_type: {
+            AST_type n = f->node;
+
+            switch (n->kind) {
+                case AST_kind_type_name:
+                    AST_pr_str(o, "type_name(");
+                    AST_pr_str(o, SYM_get_name(n->u.name));
+                    AST_pr_str(o, ")\n");
+                    break;
+
+                case AST_kind_type_array:
+                    AST_pr_str(o, "type_array(");
+                    AST_pr_str(o, SYM_get_name(n->u.array));
+                    AST_pr_str(o, ")\n");
+                    break;
+
+                case AST_kind_type_record:
+                    AST_pr_str(o, "type_record(\n");
+                    break;
+
+                default:
+                    UTL_error(-1, "Unkown type node");
+            }
+            break;
+        }
+
+        case VIS_para: {
+            AST_para n = f->node;
+
+            AST_pr_str(o, "para(\n");
+            AST_pr_attr(o, d + 1, "var:", SYM_get_name(n->name));
+            AST_pr_attr(o, d + 1, "type:", SYM_get_name(n->type));
+            AST_pr_attr(o, d + 1, "escape:", AST_pr_bool(n->escape));
+            AST_pr_attr(o, d, "", ")");
+            break;
+        }
+
+        case VIS_arg: {
+            AST_arg n = f->node;
+
+            AST_pr_str(o, "arg(\n");
+            AST_pr_attr(o, d + 1, "field:", SYM_get_name(n->name));
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+/* lines between children, before child f->step. */
+static void AST_pr_between(AST_pr_out *o, VIS_frame *f, int d)
+{
+    if (AST_pr_is_list(f->class)) {
+        if (f->step < AST_pr_len(f)) {
+            AST_pr_indent(o, d + f->step);
+            AST_pr_str(o, str_list[f->class]);
+            AST_pr_str(o, "(\n");
+        }
+        return;
+    }
+
+    if (f->class == VIS_dec && f->step == 1) {
+        AST_dec n = f->node;
+
+        if (n->kind == AST_kind_dec_func && n->u.func.ret)
+            AST_pr_attr(o, d + 1, "return:", SYM_get_name(n->u.func.ret));
+    }
+}
+
+/* tail of node, after its last child. */
+static void AST_pr_leave(AST_pr_out *o, VIS_frame *f, int d)
+{
+    if (AST_pr_is_list(f->class)) {
+        int k, len = AST_pr_len(f);
+
+        // list cells nest one level each, as if every element had its own.
+        AST_pr_indent(o, d + len);
+        AST_pr_str(o, str_list[f->class]);
+        AST_pr_str(o, "()\n");
+        for (k = len - 1; k >= 0; k--)
+            AST_pr_attr(o, d + k, "", ")");
+        return;
+    }
+
+    switch (f->class) {
+        case VIS_dec: {
+            AST_dec n = f->node;
+
+            if (n->kind == AST_kind_dec_var)
+                AST_pr_attr(o, d + 1, "escape:",
+                            AST_pr_bool(n->u.var.escape));
+            break;
+        }
+
+        case VIS_exp: {
+            AST_exp n = f->node;
+
+            switch (n->kind) {
+                case AST_kind_exp_nil:
+                case AST_kind_exp_int:
+                case AST_kind_exp_str:
+                case AST_kind_exp_break:
+                    return;
+
+                case AST_kind_exp_for:
+                    AST_pr_attr(o, d + 1, "escape:",
+                                AST_pr_bool(n->u.for_.escape));
+                    break;
+
+                default:
+                    break;
+            }
+            break;
+        }
+
+        case VIS_var:
+            // a base var is never closed, its suffix chain is.
+            if (((AST_var)f->node)->kind == AST_kind_var_base)
+                return;
+            break;
+
+        case VIS_type:
+            if (((AST_type)f->node)->kind != AST_kind_type_record)
+                return;
+            break;
+
+        case VIS_para:
+            return;
+
+        default:
+            break;
+    }
+    AST_pr_attr(o, d, "", ")");
+}
+
+static void AST_pr_step(VIS_walk w, VIS_frame *f, void *ctx)
+{
+    AST_pr_out *o = ctx;
+    AST_pr_local *l = VIS_local(f);
+    int d;
+
+    if (f->step == 0) {
+        l->d = AST_pr_depth(w);
+        AST_pr_enter(o, f, l->d);
+    }
+
+    // f is stale once a child is pushed.
+    d = l->d;
+    AST_pr_between(o, f, d);
+    if (!VIS_next(w, f))
+        AST_pr_leave(o, f, d);
+}
+
+/****************************************************************************
+ * Private: ast dump, compact and json
+ ****************************************************************************/
+
+#define AST_PR_ATTRS 3
+
+/**
+ * @brief Node as compact and json dumps see it: kind, attributes, then
+ * children in walk order.
+ */
+typedef struct AST_pr_node_
+{
+    const char *    kind;
+    int             nattr;
+    struct {
+        const char *label;
+        enum {
+            AST_pr_sym,     /*< symbol or op name, NULL if absent */
+            AST_pr_lit,     /*< string literal with its quotes */
+            AST_pr_num,
+            AST_pr_flag,
+        } type;
+        const char *s;
+        int         i;
+    } attr[AST_PR_ATTRS];
+    const char *const * child;  /*< json keys, absent children are last */
+} AST_pr_node;
+
+/**
+ * @brief Locals of a node being dumped.
+ */
+typedef struct AST_pr_keys_
+{
+    const char *const * child;  /*< json keys of its children */
+} AST_pr_keys;
+
+#define AST_PR_ATTR(nd, l, t, sv, iv) \
+    ({ (nd)->attr[(nd)->nattr].label = (l); (nd)->attr[(nd)->nattr].type = (t); \
+       (nd)->attr[(nd)->nattr].s = (sv); (nd)->attr[(nd)->nattr++].i = (iv); })
+#define AST_PR_SYM(nd, l, sym) \
+    AST_PR_ATTR(nd, l, AST_pr_sym, (sym) ? SYM_get_name(sym) : NULL, 0)
+#define AST_PR_KIDS(nd, ...) \
+    ({ static const char *const ks[] = { __VA_ARGS__ }; (nd)->child = ks; })
+
+static void AST_pr_describe(VIS_frame *f, AST_pr_node *nd)
+{
+    nd->kind  = NULL;
+    nd->nattr = 0;
+    nd->child = NULL;
+
+    switch (f->class) {
+        case VIS_exp: {
+            AST_exp n = f->node;
+
+            switch (n->kind) {
+                case AST_kind_exp_var:
+                    nd->kind = "exp_variable";
+                    AST_PR_KIDS(nd, "var");
+                    break;
+
+                case AST_kind_exp_nil:
+                    nd->kind = "exp_nil";
+                    break;
+
+                case AST_kind_exp_int:
+                    nd->kind = "exp_integer";
+                    AST_PR_ATTR(nd, "value", AST_pr_num, NULL, n->u.int_);
+                    break;
+
+                case AST_kind_exp_str:
+                    nd->kind = "exp_string";
+                    AST_PR_ATTR(nd, "value", AST_pr_lit, n->u.str_, 0);
+                    break;
+
+                case AST_kind_exp_call:
+                    nd->kind = "exp_call";
+                    AST_PR_SYM(nd, "func", n->u.call.func);
+                    AST_PR_KIDS(nd, "args");
+                    break;
+
+                case AST_kind_exp_op:
+                    nd->kind = "exp_op";
+                    AST_PR_ATTR(nd, "op", AST_pr_sym, str_op[n->u.op.oper], 0);
+                    AST_PR_KIDS(nd, "left", "right");
+                    break;
+
+                case AST_kind_exp_array:
+                    nd->kind = "exp_array";
+                    AST_PR_SYM(nd, "type", n->u.array.type);
+                    AST_PR_KIDS(nd, "size", "init");
+                    break;
+
+                case AST_kind_exp_record:
+                    nd->kind = "exp_record";
+                    AST_PR_SYM(nd, "type", n->u.record.type);
+                    AST_PR_KIDS(nd, "fields");
+                    break;
+
+                case AST_kind_exp_seq:
+                    nd->kind = "exp_sequence";
+                    AST_PR_KIDS(nd, "exps");
+                    break;
+
+                case AST_kind_exp_assign:
+                    nd->kind = "exp_assign";
+                    AST_PR_KIDS(nd, "var", "exp");
+                    break;
+
+                case AST_kind_exp_if:
+                    nd->kind = "exp_if";
+                    AST_PR_KIDS(nd, "cond", "then", "else");
+                    break;
+
+                case AST_kind_exp_while:
+                    nd->kind = "exp_while";
+                    AST_PR_KIDS(nd, "cond", "body");
+                    break;
+
+                case AST_kind_exp_for:
+                    nd->kind = "exp_for";
+                    AST_PR_SYM(nd, "var", n->u.for_.var);
+                    AST_PR_ATTR(nd, "escape", AST_pr_flag, NULL,
+                                n->u.for_.escape);
+                    AST_PR_KIDS(nd, "lo", "hi", "body");
+                    break;
+
+                case AST_kind_exp_break:
+                    nd->kind = "exp_break";
+                    break;
+
+                case AST_kind_exp_let:
+                    nd->kind = "exp_let";
+                    AST_PR_KIDS(nd, "decs", "body");
+                    break;
+
+                default:
+                    UTL_error(-1, "Unkown exp node");
+            }
+            break;
+        }
+
+        case VIS_dec: {
+            AST_dec n = f->node;
+
+            switch (n->kind) {
+                case AST_kind_dec_var:
+                    nd->kind = "dec_variable";
+                    AST_PR_SYM(nd, "name", n->u.var.name);
+                    AST_PR_SYM(nd, "type", n->u.var.type);
+                    AST_PR_ATTR(nd, "escape", AST_pr_flag, NULL,
+                                n->u.var.escape);
+                    AST_PR_KIDS(nd, "init");
+                    break;
+
+                case AST_kind_dec_type:
+                    nd->kind = "dec_type";
+                    AST_PR_SYM(nd, "name", n->u.type.name);
+                    AST_PR_KIDS(nd, "type");
+                    break;
+
+                case AST_kind_dec_func:
+                    nd->kind = "dec_function";
+                    AST_PR_SYM(nd, "name", n->u.func.name);
+                    AST_PR_SYM(nd, "return", n->u.func.ret);
+                    AST_PR_KIDS(nd, "paras", "body");
+                    break;
+
+                default:
+                    UTL_error(-1, "Unkown dec node");
+            }
+            break;
+        }
+
+        case VIS_var: {
+            AST_var n = f->node;
+
+            switch (n->kind) {
+                case AST_kind_var_base:
+                    nd->kind = "var_base";
+                    AST_PR_SYM(nd, "name", n->u.base.name);
+                    AST_PR_KIDS(nd, "suffix");
+                    break;
+
+                case AST_kind_var_index:
+                    nd->kind = "var_array_index";
+                    AST_PR_KIDS(nd, "index", "suffix");
+                    break;
+
+                case AST_kind_var_field:
+                    nd->kind = "var_record_field";
+                    AST_PR_SYM(nd, "name", n->u.field.name);
+                    AST_PR_KIDS(nd, "suffix");
+                    break;
+
+                default:
+                    UTL_error(-1, "Unkown var node");
+            }
+            break;
+        }
+
+        case VIS_type: {
+            AST_type n = f->node;
+
+            switch (n->kind) {
+                case AST_kind_type_name:
+                    nd->kind = "type_name";
+                    AST_PR_SYM(nd, "name", n->u.name);
+                    break;
+
+                case AST_kind_type_array:
+                    nd->kind = "type_array";
+                    AST_PR_SYM(nd, "element", n->u.array);
+                    break;
+
+                case AST_kind_type_record:
+                    nd->kind = "type_record";
+                    AST_PR_KIDS(nd, "fields");
+                    break;
+
+                default:
+                    UTL_error(-1, "Unkown type node");
+            }
+            break;
+        }
+
+        case VIS_para: {
+            AST_para n = f->node;
+
+            nd->kind = "para";
+            AST_PR_SYM(nd, "name", n->name);
+            AST_PR_SYM(nd, "type", n->type);
+            AST_PR_ATTR(nd, "escape", AST_pr_flag, NULL, n->escape);
+            break;
+        }
+
+        case VIS_arg: {
+            AST_arg n = f->node;
+
+            nd->kind = "arg";
+            AST_PR_SYM(nd, "name", n->name);
+            AST_PR_KIDS(nd, "exp");
+            break;
+        }
+
+        default:
+            // lists have no kind, only elements.
+            break;
+    }
+}
+
+#undef AST_PR_ATTR
+#undef AST_PR_SYM
+#undef AST_PR_KIDS
+
+/* attribute value, absent symbols are () in compact and null in json. */
+static void AST_pr_value(AST_pr_out *o, AST_pr_node *nd, int k, bool json)
+{
+    const char *s = nd->attr[k].s;
+    size_t len;
+
+    switch (nd->attr[k].type) {
+        case AST_pr_sym:
+            if (!s)
+                AST_pr_str(o, json ? "null" : "()");
+            else if (json)
+                AST_pr_json_str(o, s, strlen(s));
+            else
+                AST_pr_str(o, s);
+            break;
+
+        case AST_pr_lit:
+            len = strlen(s);
+            if (!json)
+                AST_pr_put(o, s, len);
+            else if (len >= 2 && s[0] == '"' && s[len - 1] == '"')
+                AST_pr_json_str(o, s + 1, len - 2);
+            else
+                AST_pr_json_str(o, s, len);
+            break;
+
+        case AST_pr_num:
+            AST_pr_int(o, nd->attr[k].i);
+            break;
+
+        case AST_pr_flag:
+            AST_pr_str(o, AST_pr_bool(nd->attr[k].i));
+            break;
+    }
+}
+
+/* separator, and json key, in front of node being entered. */
+static void AST_pr_lead(AST_pr_out *o, VIS_walk w, bool json)
+{
+    VIS_frame *up = VIS_up(w);
+    AST_pr_keys *keys;
+
+    if (!up)
+        return;
+
+    if (AST_pr_is_list(up->class)) {
+        if (up->step > 0)
+            AST_pr_char(o, json ? ',' : ' ');
+        return;
+    }
+
+    if (!json) {
+        AST_pr_char(o, ' ');
+        return;
+    }
+
+    keys = VIS_local(up);
+    AST_pr_char(o, ',');
+    AST_pr_json_str(o, keys->child[up->step],
+                    strlen(keys->child[up->step]));
+    AST_pr_char(o, ':');
+}
+
+static void AST_pr_data_step(VIS_walk w, VIS_frame *f, void *ctx)
+{
+    AST_pr_out *o = ctx;
+    bool json = o->format == AST_dump_json;
+    bool list = AST_pr_is_list(f->class);
+    AST_pr_node nd;
+    int k;
+
+    if (f->step == 0) {
+        AST_pr_lead(o, w, json);
+        if (list) {
+            AST_pr_char(o, json ? '[' : '(');
+        } else {
+            AST_pr_describe(f, &nd);
+            ((AST_pr_keys *)VIS_local(f))->child = nd.child;
+            AST_pr_str(o, json ? "{\"kind\":\"" : "(");
+            AST_pr_str(o, nd.kind);
+            if (json)
+                AST_pr_char(o, '"');
+            for (k = 0; k < nd.nattr; k++) {
+                if (json) {
+                    AST_pr_char(o, ',');
+                    AST_pr_json_str(o, nd.attr[k].label,
+                                    strlen(nd.attr[k].label));
+                    AST_pr_char(o, ':');
+                } else {
+                    AST_pr_char(o, ' ');
+                }
+                AST_pr_value(o, &nd, k, json);
+            }
+        }
+    }
+
+    // f is stale once a child is pushed.
+    if (!VIS_next(w, f))
+        AST_pr_char(o, json ? (list ? ']' : '}') : ')');
+}
+
+/****************************************************************************
+ * Private: ast dump
+ ****************************************************************************/
+
+static int AST_pr_dump(AST_pr_out *o, AST_exp root)
+{
+    VIS_walk w;
+
+    o->buf = malloc(AST_DUMP_SIZE);
+    if (!o->buf)
+        UTL_error(UTL_NOPOS, "run out of memory");
+    o->n      = 0;
+    o->failed = false;
+
+    if (o->format == AST_dump_tree) {
+        w = VIS_mk_walk(AST_pr_step, sizeof(AST_pr_local), o);
+    } else {
+        w = VIS_mk_walk(AST_pr_data_step, sizeof(AST_pr_keys), o);
+    }
+    VIS_run(w, VIS_exp, root);
+    if (o->format != AST_dump_tree)
+        AST_pr_char(o, '\n');
+
+    AST_pr_flush(o);
+    free(o->buf);
+
+    return o->failed ? -1 : 0;
+}
+
+/****************************************************************************
+ * Private: flat ast display, same text as pointer ast
+ ****************************************************************************/
+
+/**
+ * @brief Display work left, done last pushed first.
+ */
+typedef struct FLT_pr_job_
+{
+    enum {
+        FLT_pr_job_node,    /*< node n, nothing if 0 */
+        FLT_pr_job_close,   /*< ")" */
+        FLT_pr_job_escape,  /*< escape of node n */
+        FLT_pr_job_return,  /*< return type of function n, if any */
+        FLT_pr_job_item,    /*< item k of list n, or its end */
+    } what;
+    int         d;
+    uint32_t    n;
+    int         k;
+    const char *name;       /*< list name of item */
+} FLT_pr_job;
+
+typedef struct FLT_pr_
+{
+    FILE *      out;
+    FLT_tree    t;
+    FLT_pr_job *jobs;
+    int         n, cap;
+} FLT_pr;
+
+static void FLT_pr_push(FLT_pr *p, int what, uint32_t n, int d, int k,
+                        const char *name)
+{
+    if (p->n == p->cap) {
+        p->cap  = p->cap ? p->cap * 2 : 64;
+        p->jobs = realloc(p->jobs, p->cap * sizeof(p->jobs[0]));
+        if (!p->jobs)
+            UTL_error(UTL_NOPOS, "run out of memory");
+    }
+
+    p->jobs[p->n++] = (FLT_pr_job){ what, d, n, k, name };
+}
+
+#define FLT_PR_NODE(n, d)       FLT_pr_push(p, FLT_pr_job_node, n, d, 0, NULL)
+#define FLT_PR_CLOSE(d)         FLT_pr_push(p, FLT_pr_job_close, 0, d, 0, NULL)
+#define FLT_PR_ESCAPE(n, d)     FLT_pr_push(p, FLT_pr_job_escape, n, d, 0, NULL)
+#define FLT_PR_LIST(l, d, name) FLT_pr_push(p, FLT_pr_job_item, l, d, 0, name)
+
+/* list cells nest one level each, as in AST_pr_between(). */
+static void FLT_pr_item(FLT_pr *p, FLT_list l, int d, int k,
+                        const char *name)
+{
+    FILE *out = p->out;
+    int len = FLT_len(p->t, l);
+
+    if (k < len) {
+        WHITE(d + k); fprintf(out, "%s(\n", name);
+        FLT_pr_push(p, FLT_pr_job_item, l, d, k + 1, name);
+        FLT_PR_NODE(FLT_at(p->t, l, k), d + k + 1);
+        return;
+    }
+
+    // close list cells, WHITE() has its own i, keep it out of the depth.
+    WHITE(d + len); fprintf(out, "%s()\n", name);
+    for (k = len - 1; k >= 0; k--) {
+        WHITE(d + k); fprintf(out, ")\n");
+    }
+}
+
+static void FLT_pr_dec(FLT_pr *p, FLT_node n, int d)
+{
+    FILE *out = p->out;
+    FLT_tree t = p->t;
+
     WHITE(d);
-    switch(n->kind) {
+    FLT_PR_CLOSE(d);
+    switch (FLT_kind(t, n)) {
         case AST_kind_dec_var:
             fprintf(out, "dec_variable(\n");
-            if (n->u.var.type) {
+            if (FLT_dec_var_type(t, n)) {
                 WHITE(d + 1); fprintf(out, "type:%s\n",
-                                      SYM_get_name(n->u.var.type));
+                                      SYM_get_name(FLT_dec_var_type(t, n)));
             }
-            AST_pr_exp(out, n->u.var.init, d + 1);
-            WHITE(d + 1); fprintf(out, "escape:%s\n",
-                                  n->u.var.escape ? "true" : "false");
+            FLT_PR_ESCAPE(n, d + 1);
+            FLT_PR_NODE(FLT_dec_var_init(t, n), d + 1);
             break;
 
         case AST_kind_dec_type:
             fprintf(out, "dec_type(\n");
             WHITE(d + 1); fprintf(out, "name:%s\n",
-                                  SYM_get_name(n->u.type.name));
-            AST_pr_type(out, n->u.type.type, d + 1);
+                                  SYM_get_name(FLT_dec_type_name(t, n)));
+            FLT_PR_NODE(FLT_dec_type_type(t, n), d + 1);
             break;
 
         case AST_kind_dec_func:
             fprintf(out, "dec_function(\n");
-            WHITE(d + 1); fprintf(out, "name:%s\n", SYM_get_name(n->u.func.name));
-            AST_pr_para_list(out, n->u.func.paras, d + 1);
-            if (n->u.func.ret) {
-                WHITE(d + 1); fprintf(out, "return:%s\n",
-                                      SYM_get_name(n->u.func.ret));
-            }
-            AST_pr_exp(out, n->u.func.body, d + 1);
+            WHITE(d + 1); fprintf(out, "name:%s\n",
+                                  SYM_get_name(FLT_dec_func_name(t, n)));
+            FLT_PR_NODE(FLT_dec_func_body(t, n), d + 1);
+            FLT_pr_push(p, FLT_pr_job_return, n, d + 1, 0, NULL);
+            FLT_PR_LIST(FLT_dec_func_paras(t, n), d + 1, "para_list");
             break;
 
         default:
             UTL_error(-1, "Unkown dec node");
     }
-    WHITE(d); fprintf(out, ")\n");
 }
 
-static void AST_pr_exp(FILE *out, AST_exp n, int d)
+static void FLT_pr_exp(FLT_pr *p, FLT_node n, int d)
 {
-    WHITE(d);
-    switch(n->kind) {
-        case AST_kind_exp_var:
-            fprintf(out, "exp_variable(\n");
-            AST_pr_var(out, n->u.var, d + 1);
-            break;
+    FILE *out = p->out;
+    FLT_tree t = p->t;
 
+    WHITE(d);
+    switch (FLT_kind(t, n)) {
         case AST_kind_exp_nil:
             fprintf(out, "exp_nil()\n");
             return;
 
         case AST_kind_exp_int:
-            fprintf(out, "exp_integer(%d)\n", n->u.int_);
+            fprintf(out, "exp_integer(%d)\n", FLT_exp_int(t, n));
             return;
 
         case AST_kind_exp_str:
-            fprintf(out, "exp_string(%s)\n", n->u.str_);
+            fprintf(out, "exp_string(%s)\n", FLT_exp_str(t, n));
+            return;
+
+        case AST_kind_exp_break:
+            fprintf(out, "exp_break(\n");
             return;
+    }
+
+    FLT_PR_CLOSE(d);
+    switch (FLT_kind(t, n)) {
+        case AST_kind_exp_var:
+            fprintf(out, "exp_variable(\n");
+            FLT_PR_NODE(FLT_exp_var(t, n), d + 1);
+            break;
 
         case AST_kind_exp_call:
             fprintf(out, "exp_call(\n");
-            WHITE(d + 1); fprintf(out, "func:%s\n", SYM_get_name(n->u.call.func));
-            AST_pr_exp_list(out, n->u.call.args, d + 1);
+            WHITE(d + 1); fprintf(out, "func:%s\n",
+                                  SYM_get_name(FLT_exp_call_func(t, n)));
+            FLT_PR_LIST(FLT_exp_call_args(t, n), d + 1, "exp_list");
             break;
 
         case AST_kind_exp_op:
             fprintf(out, "exp_op(\n");
-            WHITE(d + 1); AST_pr_op(out, n->u.op.oper); fprintf(out, "\n");
-            AST_pr_exp(out, n->u.op.left, d + 1);
-            AST_pr_exp(out, n->u.op.right, d + 1);
+            WHITE(d + 1); fprintf(out, "%s\n", str_op[FLT_exp_op_oper(t, n)]);
+            FLT_PR_NODE(FLT_exp_op_right(t, n), d + 1);
+            FLT_PR_NODE(FLT_exp_op_left(t, n), d + 1);
             break;
 
         case AST_kind_exp_array:
             fprintf(out, "exp_array(\n");
             WHITE(d + 1); fprintf(out, "array:%s\n",
-                                  SYM_get_name(n->u.array.type));
-            AST_pr_exp(out, n->u.array.size, d + 1);
-            AST_pr_exp(out, n->u.array.init, d + 1);
+                                  SYM_get_name(FLT_exp_array_type(t, n)));
+            FLT_PR_NODE(FLT_exp_array_init(t, n), d + 1);
+            FLT_PR_NODE(FLT_exp_array_size(t, n), d + 1);
             break;
 
         case AST_kind_exp_record:
             fprintf(out, "exp_record(\n");
-            AST_pr_arg_list(out, n->u.record.args, d + 1);
+            FLT_PR_LIST(FLT_exp_record_args(t, n), d + 1, "arg_list");
             break;
 
         case AST_kind_exp_seq:
             fprintf(out, "exp_sequence(\n");
-            AST_pr_exp_list(out, n->u.seq, d + 1);
+            FLT_PR_LIST(FLT_exp_seq(t, n), d + 1, "exp_list");
             break;
 
         case AST_kind_exp_assign:
             fprintf(out, "exp_assign(\n");
-            AST_pr_var(out, n->u.assign.var, d + 1);
-            AST_pr_exp(out, n->u.assign.exp, d + 1);
+            FLT_PR_NODE(FLT_exp_assign_exp(t, n), d + 1);
+            FLT_PR_NODE(FLT_exp_assign_var(t, n), d + 1);
             break;
 
         case AST_kind_exp_if:
             fprintf(out, "exp_if(\n");
-            AST_pr_exp(out, n->u.if_.cond, d + 1);
-            AST_pr_exp(out, n->u.if_.then, d + 1);
-            if (n->u.if_.else_) {
-                AST_pr_exp(out, n->u.if_.else_, d + 1);
-            }
+            FLT_PR_NODE(FLT_exp_if_else(t, n), d + 1);
+            FLT_PR_NODE(FLT_exp_if_then(t, n), d + 1);
+            FLT_PR_NODE(FLT_exp_if_cond(t, n), d + 1);
             break;
 
         case AST_kind_exp_while:
             fprintf(out, "exp_while(\n");
-            AST_pr_exp(out, n->u.while_.cond, d + 1);
-            AST_pr_exp(out, n->u.while_.body, d + 1);
+            FLT_PR_NODE(FLT_exp_while_body(t, n), d + 1);
+            FLT_PR_NODE(FLT_exp_while_cond(t, n), d + 1);
             break;
 
         case AST_kind_exp_for:
             fprintf(out, "exp_for(\n");
-            WHITE(d + 1); fprintf(out, "var:%s\n", SYM_get_name(n->u.for_.var));
-            AST_pr_exp(out, n->u.for_.lo, d + 1);
-            AST_pr_exp(out, n->u.for_.hi, d + 1);
-            AST_pr_exp(out, n->u.for_.body, d + 1);
-            WHITE(d + 1); fprintf(out, "escape:%s\n",
-                                  n->u.for_.escape ? "true" : "false");
+            WHITE(d + 1); fprintf(out, "var:%s\n",
+                                  SYM_get_name(FLT_exp_for_var(t, n)));
+            FLT_PR_ESCAPE(n, d + 1);
+            FLT_PR_NODE(FLT_exp_for_body(t, n), d + 1);
+            FLT_PR_NODE(FLT_exp_for_hi(t, n), d + 1);
+            FLT_PR_NODE(FLT_exp_for_lo(t, n), d + 1);
             break;
 
-        case AST_kind_exp_break:
-            fprintf(out, "exp_break(\n");
-            return;
-
         case AST_kind_exp_let:
             fprintf(out, "exp_let(\n");
-            AST_pr_dec_list(out, n->u.let.decs, d + 1);
-            AST_pr_exp_list(out, n->u.let.body, d + 1);
+            FLT_PR_LIST(FLT_exp_let_body(t, n), d + 1, "exp_list");
+            FLT_PR_LIST(FLT_exp_let_decs(t, n), d + 1, "dec_list");
             break;
 
         default:
             UTL_error(-1, "Unkown exp node");
     }
-    WHITE(d); fprintf(out, ")\n");
 }
 
-static void AST_pr_var(FILE *out, AST_var n, int d)
+static void FLT_pr_var(FLT_pr *p, FLT_node n, int d)
 {
-    if (n) {
-        WHITE(d);
-        switch(n->kind) {
-            case AST_kind_var_base:
-                fprintf(out, "var_base(\n");
-                WHITE(d + 1); fprintf(out, "base:%s\n",
-                                      SYM_get_name(n->u.base.name));
-                AST_pr_var(out, n->u.index.suffix, d + 1);
-                return;
+    FILE *out = p->out;
+    FLT_tree t = p->t;
 
-            case AST_kind_var_index:
-                fprintf(out, "var_array_index(\n");
-                AST_pr_exp(out, n->u.index.exp, d + 1);
-                AST_pr_var(out, n->u.index.suffix, d + 1);
-                break;
-
-            case AST_kind_var_field:
-                fprintf(out, "var_record_field(\n");
-                WHITE(d + 1); fprintf(out, "field:%s\n",
-                                      SYM_get_name(n->u.field.name));
-                AST_pr_var(out, n->u.index.suffix, d + 1);
-                break;
-
-            default:
-                UTL_error(-1, "Unkown var node");
-        }
-        WHITE(d); fprintf(out, ")\n");
+    WHITE(d);
+    switch (FLT_kind(t, n)) {
+        case AST_kind_var_base:
+            fprintf(out, "var_base(\n");
+            WHITE(d + 1); fprintf(out, "base:%s\n",
+                                  SYM_get_name(FLT_var_base_name(t, n)));
+            FLT_PR_NODE(FLT_var_suffix(t, n), d + 1);
+            return;
+
+        case AST_kind_var_index:
+            fprintf(out, "var_array_index(\n");
+            FLT_PR_CLOSE(d);
+            FLT_PR_NODE(FLT_var_suffix(t, n), d + 1);
+            FLT_PR_NODE(FLT_var_index_exp(t, n), d + 1);
+            break;
+
+        case AST_kind_var_field:
+            fprintf(out, "var_record_field(\n");
+            WHITE(d + 1); fprintf(out, "field:%s\n",
+                                  SYM_get_name(FLT_var_field_name(t, n)));
+            FLT_PR_CLOSE(d);
+            FLT_PR_NODE(FLT_var_suffix(t, n), d + 1);
+            break;
+
+        default:
+            UTL_error(-1, "Unkown var node");
     }
 }
 
-static void AST_pr_type(FILE *out, AST_type n, int d)
+static void FLT_pr_type(FLT_pr *p, FLT_node n, int d)
 {
+    FILE *out = p->out;
+    FLT_tree t = p->t;
+
     WHITE(d);
-    switch(n->kind) {
+    switch (FLT_kind(t, n)) {
         case AST_kind_type_name:
-            fprintf(out, "type_name(%s)\n", SYM_get_name(n->u.name));
+            fprintf(out, "type_name(%s)\n", SYM_get_name(FLT_type_name(t, n)));
             return;
 
         case AST_kind_type_array:
-            fprintf(out, "type_array(%s)\n", SYM_get_name(n->u.array));
+            fprintf(out, "type_array(%s)\n",
+                    SYM_get_name(FLT_type_array(t, n)));
             return;
 
         case AST_kind_type_record:
             fprintf(out, "type_record(\n");
-            AST_pr_para_list(out, n->u.record, d + 1);
+            FLT_PR_CLOSE(d);
+            FLT_PR_LIST(FLT_type_record(t, n), d + 1, "para_list");
             break;
 
         default:
             UTL_error(-1, "Unkown type node");
     }
-    WHITE(d); fprintf(out, ")\n");
 }
 
-static void AST_pr_dec_list(FILE *out, AST_dec_list n, int d)
+static void FLT_pr_node(FLT_pr *p, FLT_node n, int d)
 {
-    WHITE(d); fprintf(out, "dec_list(");
-    if (n) {
-        fprintf(out, "\n");
-        AST_pr_dec(out, n->head, d + 1);
-        AST_pr_dec_list(out, n->tail, d + 1);
-        WHITE(d);
-    }
-    fprintf(out, ")\n");
-}
+    FILE *out = p->out;
+    FLT_tree t = p->t;
 
-static void AST_pr_exp_list(FILE *out, AST_exp_list n, int d)
-{
-    WHITE(d); fprintf(out, "exp_list(");
-    if (n) {
-        fprintf(out, "\n");
-        AST_pr_exp(out, n->head, d + 1);
-        AST_pr_exp_list(out, n->tail, d + 1);
-        WHITE(d);
-    }
-    fprintf(out, ")\n");
-}
+    // optional children print nothing, as AST_pr_var() of NULL.
+    if (!n)
+        return;
 
-static void AST_pr_para(FILE *out, AST_para n, int d)
-{
-    WHITE(d); fprintf(out, "para(\n");
-    WHITE(d + 1); fprintf(out, "var:%s\n", SYM_get_name(n->name));
-    WHITE(d + 1); fprintf(out, "type:%s\n", SYM_get_name(n->type));
-    WHITE(d + 1); fprintf(out, "escape:%s\n", n->escape ? "true" : "false");
-    WHITE(d); fprintf(out, ")\n");
-}
+    switch (FLT_class_of(t, n)) {
+        case FLT_class_exp:
+            FLT_pr_exp(p, n, d);
+            break;
 
-static void AST_pr_para_list(FILE *out, AST_para_list n, int d)
-{
-    WHITE(d); fprintf(out, "para_list(");
-    if (n) {
-        fprintf(out, "\n");
-        AST_pr_para(out, n->head, d + 1);
-        AST_pr_para_list(out, n->tail, d + 1);
-        WHITE(d);
+        case FLT_class_dec:
+            FLT_pr_dec(p, n, d);
+            break;
+
+        case FLT_class_var:
+            FLT_pr_var(p, n, d);
+            break;
+
+        case FLT_class_type:
+            FLT_pr_type(p, n, d);
+            break;
+
+        case FLT_class_para:
+            WHITE(d); fprintf(out, "para(\n");
+            WHITE(d + 1); fprintf(out, "var:%s\n",
+                                  SYM_get_name(FLT_para_name(t, n)));
+            WHITE(d + 1); fprintf(out, "type:%s\n",
+                                  SYM_get_name(FLT_para_type(t, n)));
+            WHITE(d + 1); fprintf(out, "escape:%s\n",
+                                  FLT_escape(t, n) ? "true" : "false");
+            WHITE(d); fprintf(out, ")\n");
+            break;
+
+        case FLT_class_arg:
+            WHITE(d); fprintf(out, "arg(\n");
+            WHITE(d + 1); fprintf(out, "field:%s\n",
+                                  SYM_get_name(FLT_arg_name(t, n)));
+            FLT_PR_CLOSE(d);
+            FLT_PR_NODE(FLT_arg_exp(t, n), d + 1);
+            break;
     }
-    fprintf(out, ")\n");
 }
 
-static void AST_pr_arg(FILE *out, AST_arg n, int d)
-{
-    WHITE(d); fprintf(out, "arg(\n");
-    WHITE(d + 1); fprintf(out, "field:%s\n", SYM_get_name(n->name));
-    AST_pr_exp(out, n->exp, d + 1);
-    WHITE(d); fprintf(out, ")\n");
-}
+#undef FLT_PR_NODE
+#undef FLT_PR_CLOSE
+#undef FLT_PR_ESCAPE
+#undef FLT_PR_LIST
 
-static void AST_pr_arg_list(FILE *out, AST_arg_list n, int d)
+/* do one job, it may push more. */
+static void FLT_pr_do(FLT_pr *p, FLT_pr_job j)
 {
-    WHITE(d); fprintf(out, "arg_list(");
-    if (n) {
-        fprintf(out, "\n");
-        AST_pr_arg(out, n->head, d + 1);
-        AST_pr_arg_list(out, n->tail, d + 1);
-        WHITE(d);
+    FILE *out = p->out;
+    FLT_tree t = p->t;
+
+    switch (j.what) {
+        case FLT_pr_job_node:
+            FLT_pr_node(p, j.n, j.d);
+            break;
+
+        case FLT_pr_job_close:
+            WHITE(j.d); fprintf(out, ")\n");
+            break;
+
+        case FLT_pr_job_escape:
+            WHITE(j.d); fprintf(out, "escape:%s\n",
+                                FLT_escape(t, j.n) ? "true" : "false");
+            break;
+
+        case FLT_pr_job_return:
+            if (FLT_dec_func_ret(t, j.n)) {
+                WHITE(j.d); fprintf(out, "return:%s\n",
+                                    SYM_get_name(FLT_dec_func_ret(t, j.n)));
+            }
+            break;
+
+        case FLT_pr_job_item:
+            FLT_pr_item(p, j.n, j.d, j.k, j.name);
+            break;
     }
-    fprintf(out, ")\n");
 }
 
 /****************************************************************************
@@ -339,6 +1307,10 @@ static void TY_pr_type(FILE *out, TY_type t)
             fprintf(out, "%s", str_type[t->kind]);
             break;
 
+        case TY_kind_poison:
+            fprintf(out, "poison");
+            break;
+
         case TY_kind_name:
             fprintf(out, "`%s", SYM_get_name(t->u.name.symbol));
             break;
@@ -394,7 +1366,35 @@ static void TY_pr_field_list(FILE *out, TY_field_list t)
 
 void AST_print(FILE *out, AST_exp root)
 {
-    AST_pr_exp(out, root, 0);
+    AST_dump(out, root, AST_dump_tree);
+}
+
+int AST_dump(FILE *out, AST_exp root, AST_dump_format format)
+{
+    AST_pr_out o = { .format = format, .file = out };
+
+    return AST_pr_dump(&o, root);
+}
+
+int AST_dump_fd(int fd, AST_exp root, AST_dump_format format)
+{
+    AST_pr_out o = { .format = format, .fd = fd };
+
+    return AST_pr_dump(&o, root);
+}
+
+void FLT_print(FILE *out, FLT_tree t)
+{
+    FLT_pr p = { out, t, NULL, 0, 0 };
+
+    // jobs stand in for recursion, deep trees need no machine stack.
+    FLT_pr_node(&p, t->root, 0);
+    while (p.n > 0) {
+        p.n--;
+        FLT_pr_do(&p, p.jobs[p.n]);
+    }
+
+    free(p.jobs);
 }
 
 void TY_print(FILE *out, TY_type type)
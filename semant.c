@@ -3,18 +3,23 @@
  ****************************************************************************/
 
 #include <stdbool.h>
+#include "context.h"
 #include "env.h"
 #include "semant.h"
 #include "symbol.h"
 #include "translate.h"
 #include "type.h"
 #include "util.h"
+#include "visit.h"
 
 /****************************************************************************
  * Definitions
  ****************************************************************************/
 
-#define printt(x,y) ({ printf("%s\t", x); TY_print(stdout, y); printf("\n"); })
+#define printt(x,y) \
+    ({ if (!UTL_is_quiet()) { \
+           fprintf(TIGER_out(), "%s\t", x); TY_print(TIGER_out(), y); \
+           fprintf(TIGER_out(), "\n"); } })
 
 typedef void *IR_ir;             /*< ir not implemented yet */
 
@@ -26,10 +31,74 @@ struct SMT_tyir_
     TY_type  type;
 };
 
+/**
+ * @brief Semantic state of a context.
+ */
+typedef struct SMT_state_
+{
+    SMT_func_hook   func_hook;
+} SMT_state;
+
+/**
+ * @brief Environments of a check, context of its walk.
+ */
+typedef struct SMT_env_
+{
+    SYM_table   venv;
+    SYM_table   tenv;
+} SMT_env;
+
+/**
+ * @brief Parts of a let, checked in this order after its types.
+ */
+enum {
+    SMT_let_vars,
+    SMT_let_funcs,
+    SMT_let_body,
+};
+
+/**
+ * @brief Locals of a node being checked.
+ */
+typedef struct SMT_local_
+{
+    SMT_tyir    tyir;   /*< result, read by parent once done */
+    int         loop;   /*< loop layer counter, set by parent */
+    int         phase;  /*< let, part being checked */
+    int         i;      /*< let, next dec or body exp */
+    bool        bad;    /*< func or record poisoned, args checked alone */
+    TY_type     t;      /*< func, array or record type, var type so far */
+    void *      p;      /*< paras or fields left, let dummys, var suffix */
+    SMT_tyir    keep;   /*< earlier child result */
+} SMT_local;
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
 
+/**
+ * @brief State of current context.
+ */
+static inline SMT_state *SMT_cur(void)
+{
+    TIGER_ctx ctx = TIGER_cur();
+
+    if (__builtin_expect(!ctx->smt, 0))
+        ctx->smt = TIGER_mk_state(sizeof(*ctx->smt));
+
+    return ctx->smt;
+}
+
+/**
+ * @brief Type is of kind, or poison which passes every check silently.
+ */
+static inline bool SMT_is(TY_type type, int kind)
+{
+    int k = TY_get_kind(type);
+
+    return k == kind || k == TY_kind_poison;
+}
+
 static SMT_tyir SMT_mk_tyir(IR_ir ir, TY_type type)
 {
     SMT_tyir e;
@@ -45,34 +114,47 @@ static SMT_tyir SMT_mk_tyir(IR_ir ir, TY_type type)
  ****************************************************************************/
 
 /**
- * @brief Translate declarations.
+ * @brief Translate type declarations of a let.
  * can detect loop type definitions; support recursive definitions.
- * @param[in] venv  value environment for variables and functions.
  * @param[in] tenv  type environment for types.
  * @param[in] n     astnode.
+ * @return TY_type_list dummy types, free once functions are checked.
  */
-static void SMT_trans_dec(SYM_table venv, SYM_table tenv, AST_dec_list n);
+static TY_type_list SMT_trans_types(SYM_table tenv, AST_dec_list n);
 
 /**
- * @brief Translate expressions.
- * support break validity.
+ * @brief Advertise function heads of a let (paras -> ret).
  * @param[in] venv  value environment for variables and functions.
  * @param[in] tenv  type environment for types.
  * @param[in] n     astnode.
- * @param[in] loop  loop layer counter.
- * @return SMT_tyir   translated ir with type.
  */
-static SMT_tyir SMT_trans_exp(SYM_table venv, SYM_table tenv, AST_exp n,
-                              int loop);
+static void SMT_trans_heads(SYM_table venv, SYM_table tenv, AST_dec_list n);
 
 /**
- * @brief Translate variables(lvalue).
- * @param[in] venv  value environment for variables and functions.
- * @param[in] tenv  type environment for types.
- * @param[in] n     astnode.
- * @return SMT_tyir   translated ir with type.
+ * @brief Translate expressions, one step of check walk.
+ * support break validity, loop layer counter is in locals.
+ * @param[in] w     check walk.
+ * @param[in] f     frame of expression.
+ * @param[in] env   environments.
+ */
+static void SMT_step_exp(VIS_walk w, VIS_frame *f, SMT_env *env);
+
+/**
+ * @brief Translate variables(lvalue), one step of check walk.
+ * @param[in] w     check walk.
+ * @param[in] f     frame of base variable.
+ * @param[in] env   environments.
+ */
+static void SMT_step_var(VIS_walk w, VIS_frame *f, SMT_env *env);
+
+/**
+ * @brief Translate variable and function declarations, one step of check
+ * walk. types and function heads are done by their let.
+ * @param[in] w     check walk.
+ * @param[in] f     frame of declaration.
+ * @param[in] env   environments.
  */
-static SMT_tyir SMT_trans_var(SYM_table venv, SYM_table tenv, AST_var n);
+static void SMT_step_dec(VIS_walk w, VIS_frame *f, SMT_env *env);
 
 /**
  * @brief Translate types.
@@ -91,35 +173,84 @@ static TY_type SMT_trans_type(SYM_table tenv, AST_type n);
  */
 static void SMT_trans_init(SYM_table venv, SYM_table tenv);
 
-static void SMT_trans_dec(SYM_table venv, SYM_table tenv, AST_dec_list n)
+static void SMT_step(VIS_walk w, VIS_frame *f, void *ctx)
+{
+    switch(f->class) {
+        case VIS_exp:
+            SMT_step_exp(w, f, ctx);
+            break;
+
+        case VIS_var:
+            SMT_step_var(w, f, ctx);
+            break;
+
+        case VIS_dec:
+            SMT_step_dec(w, f, ctx);
+            break;
+
+        default:
+            UTL_error(UTL_NOPOS, "unkown node to check");
+    }
+}
+
+/**
+ * @brief Check tree from node, ir with type of it is dropped.
+ */
+static void SMT_check(SYM_table venv, SYM_table tenv, VIS_class class,
+                      void *node)
+{
+    SMT_env env = { venv, tenv };
+
+    VIS_run(VIS_mk_walk(SMT_step, sizeof(SMT_local), &env), class, node);
+}
+
+/* push child, frame and locals of parent are stale after it. */
+static inline void SMT_push(VIS_walk w, VIS_class class, void *node, int loop)
+{
+    SMT_local *c = VIS_push(w, class, node);
+
+    c->loop = loop;
+}
+
+static inline SMT_tyir SMT_done(VIS_walk w)
+{
+    return ((SMT_local *)VIS_done(w))->tyir;
+}
+
+/* push next dec of kind from *i, false if there is none. */
+static bool SMT_next_dec(VIS_walk w, AST_dec_list n, int *i, unsigned kind)
+{
+    while (*i < AST_LEN(n)) {
+        AST_dec dec = n->items[(*i)++];
+
+        if (dec->kind == kind) {
+            SMT_push(w, VIS_dec, dec, 0);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static TY_type_list SMT_trans_types(SYM_table tenv, AST_dec_list n)
 {
-    AST_dec_list  vars   = NULL;
-    AST_dec_list  types  = NULL;
-    AST_dec_list  funcs  = NULL;
     TY_type_list  dummys = NULL;
-    AST_dec_list  p, v, t, f;
     TY_type_list  d;
+    int           ndummy = 0;
+    int           i;
 
     //////////////////////////////////////////////////////////////////////////
     // Declarations Separation
     //////////////////////////////////////////////////////////////////////////
 
-    // separate decs into 3 list: variables, types, functions.
-    for (p = n; p; p = p->tail) {
-        AST_dec dec = p->head;
+    // decs are taken by kind: types here, variables and functions by walk.
+    for (i = 0; i < AST_LEN(n); i++) {
+        AST_dec dec = n->items[i];
 
         switch(dec->kind) {
-            case AST_kind_dec_var: {
-                // make variable declaratoin list
-                if (!vars) {
-                    v = AST_mk_dec_list(dec, NULL);
-                    vars = v;
-                } else {
-                    v->tail = AST_mk_dec_list(dec, NULL);
-                    v = v->tail;
-                }
+            case AST_kind_dec_var:
+            case AST_kind_dec_func:
                 break;
-            }
 
             case AST_kind_dec_type: {
                 SYM_symbol name  = dec->u.type.name;
@@ -127,6 +258,7 @@ static void SMT_trans_dec(SYM_table venv, SYM_table tenv, AST_dec_list n)
 
                 // advertise dummy type
                 SYM_enter(tenv, name, dummy);
+                ndummy++;
 
                 if (!dummys) {
                     d = TY_mk_type_list(dummy, NULL);
@@ -135,27 +267,6 @@ static void SMT_trans_dec(SYM_table venv, SYM_table tenv, AST_dec_list n)
                     d->tail = TY_mk_type_list(dummy, NULL);
                     d = d->tail;
                 }
-
-                // make type declaratoin list
-                if (!types) {
-                    t = AST_mk_dec_list(dec, NULL);
-                    types = t;
-                } else {
-                    t->tail = AST_mk_dec_list(dec, NULL);
-                    t = t->tail;
-                }
-                break;
-            }
-
-            case AST_kind_dec_func: {
-                // make function declaratoin list
-                if (!funcs) {
-                    f = AST_mk_dec_list(dec, NULL);
-                    funcs = f;
-                } else {
-                    f->tail = AST_mk_dec_list(dec, NULL);
-                    f = f->tail;
-                }
                 break;
             }
 
@@ -169,104 +280,109 @@ static void SMT_trans_dec(SYM_table venv, SYM_table tenv, AST_dec_list n)
     //////////////////////////////////////////////////////////////////////////
 
     // translate type definitions
-    for (t = types; t; t = t->tail) {
-        AST_dec    dec  = t->head;
-        SYM_symbol name = dec->u.type.name;
-        AST_type   type = dec->u.type.type;
-        TY_type    type_ty = SMT_trans_type(tenv, type);
+    for (i = 0; i < AST_LEN(n); i++) {
+        AST_dec    dec  = n->items[i];
+        SYM_symbol name;
+        AST_type   type;
+        TY_type    type_ty;
+
+        if (dec->kind != AST_kind_dec_type)
+            continue;
+
+        name    = dec->u.type.name;
+        type    = dec->u.type.type;
+        type_ty = SMT_trans_type(tenv, type);
 
         // cover dummy with raw definitions
         SYM_enter(tenv, name, type_ty);
     }
 
-    // replace dummy type with translated definitions
-    for (d = dummys; d; d = d->tail) {
-        TY_type    dummy  = d->head;
-        SYM_symbol symbol = dummy->u.name.symbol;
-        SYM_symbol s      = symbol;
-
-        while(1) {
-            TY_type look = SYM_look(tenv, s);
-
-            if (look->kind == TY_kind_name) {
-                SYM_symbol lsymbol = look->u.name.symbol;
-                TY_type   ltype   = look->u.name.type;
-
-                // detect illegal loop definition
-                if (lsymbol == symbol)
-                    UTL_error(UTL_NOPOS, "LOOP");
-
-                s = lsymbol;
-            } else {
-                dummy->u.name.type = look;
-                break;
+    // replace dummy types with what their alias chains end in. a chain of
+    // more dummys than the let has ran into a loop, which is reported once
+    // and poisons every type on it and leading into it.
+    for (i = 0, d = dummys; d; d = d->tail, i++) {
+        AST_dec dec = n->items[i];
+        TY_type look, next, type;
+        int     k;
+
+        while (dec->kind != AST_kind_dec_type)
+            dec = n->items[++i];
+
+        for (k = 0, look = d->head; k <= ndummy && look->kind == TY_kind_name
+             && !look->u.name.type; k++)
+            look = SYM_look(tenv, look->u.name.symbol);
+
+        if (look->kind != TY_kind_name) {
+            type = look;
+        } else if (look->u.name.type) {
+            type = look->u.name.type;
+        } else {
+            UTL_diag(dec->pos, "type(%s), illegal loop definition",
+                    SYM_get_name(dec->u.type.name));
+            type = TY_poison();
+
+            for (; !look->u.name.type; look = next) {
+                next = SYM_look(tenv, look->u.name.symbol);
+                look->u.name.type = type;
             }
         }
-    }
-
-    //////////////////////////////////////////////////////////////////////////
-    // Vatiable Declarations
-    //////////////////////////////////////////////////////////////////////////
 
-    // translate variable definitions
-    for (v = vars; v; v = v->tail) {
-        AST_dec    dec  = v->head;
-        SYM_symbol name = dec->u.var.name;
-        SYM_symbol type = dec->u.var.type;
-        AST_exp    init = dec->u.var.init;
-        TY_type    type_ty;
-        SMT_tyir   init_tyir;
-
-        // check variable init.
-        init_tyir = SMT_trans_exp(venv, tenv, init, 0);
-        if (type) {
-            type_ty = SYM_look(tenv, type);
-            if (!TY_match(init_tyir.type, type_ty)) {
-                printt("type", type_ty);
-                printt("init", init_tyir.type);
-                UTL_error(dec->pos, "dec var(%s), type not match\n",
-                        SYM_get_name(name));
-            }
+        // resolve the chain on the way, each dummy is followed once.
+        for (look = d->head; look->kind == TY_kind_name && !look->u.name.type;
+             look = next) {
+            next = SYM_look(tenv, look->u.name.symbol);
+            look->u.name.type = type;
         }
-
-        SYM_enter(venv, name, init_tyir.type);
     }
 
+    return dummys;
+}
+
+static void SMT_trans_heads(SYM_table venv, SYM_table tenv, AST_dec_list n)
+{
+    int i;
+
     //////////////////////////////////////////////////////////////////////////
     // Function Declarations
     //////////////////////////////////////////////////////////////////////////
 
     // advertise function heads (paras -> ret)
-    for (f = funcs; f; f = f->tail) {
-        AST_dec       dec   = f->head;
-        SYM_symbol    fname = dec->u.func.name;
-        AST_para_list paras = dec->u.func.paras;
-        SYM_symbol    ret   = dec->u.func.ret;
-        AST_exp       body  = dec->u.func.body;
+    for (i = 0; i < AST_LEN(n); i++) {
+        AST_dec       dec   = n->items[i];
+        SYM_symbol    fname, ret;
+        AST_para_list paras;
 
         TY_type_list  para_tys;
         TY_type       ret_ty;
-        SMT_tyir      body_tyir;
 
-        AST_para_list p;
         TY_type_list  t;
+        int           k;
+
+        if (dec->kind != AST_kind_dec_func)
+            continue;
+
+        fname = dec->u.func.name;
+        paras = dec->u.func.paras;
+        ret   = dec->u.func.ret;
 
         // check return type.
         ret_ty = ret ? SYM_look(tenv, ret) : TY_void();
         if (!ret_ty) {
-            UTL_error(dec->pos, "dec fuc(%s), ret(%s) not defined",
+            UTL_diag(dec->pos, "dec fuc(%s), ret(%s) not defined",
                     SYM_get_name(fname), SYM_get_name(ret));
+            ret_ty = TY_poison();
         }
 
         // check parameter type.
-        for (p = paras, para_tys = NULL; p; p = p->tail) {
-            SYM_symbol type = p->head->type;
+        for (k = 0, para_tys = NULL; k < AST_LEN(paras); k++) {
+            SYM_symbol type = paras->items[k]->type;
             TY_type para_ty;
 
             para_ty = SYM_look(tenv, type);
             if (!para_ty) {
-                UTL_error(dec->pos, "dec func(%s), para(%s) not defined",
+                UTL_diag(dec->pos, "dec func(%s), para(%s) not defined",
                         SYM_get_name(fname), SYM_get_name(type));
+                para_ty = TY_poison();
             }
 
             // make parameter list.
@@ -281,107 +397,193 @@ static void SMT_trans_dec(SYM_table venv, SYM_table tenv, AST_dec_list n)
 
         SYM_enter(venv, fname, TY_mk_func(ret_ty, para_tys));
     }
+}
+
+static void SMT_step_dec(VIS_walk w, VIS_frame *f, SMT_env *env)
+{
+    SYM_table venv = env->venv;
+    SYM_table tenv = env->tenv;
+    AST_dec   dec  = f->node;
+
+    switch(dec->kind) {
+        case AST_kind_dec_var: {
+            SYM_symbol name = dec->u.var.name;
+            SYM_symbol type = dec->u.var.type;
+            TY_type    type_ty;
+            SMT_tyir   init_tyir;
+
+            // check variable init.
+            if (f->step == 0) {
+                SMT_push(w, VIS_exp, dec->u.var.init, 0);
+                return;
+            }
+
+            init_tyir = SMT_done(w);
+            if (type) {
+                type_ty = SYM_look(tenv, type);
+                if (!type_ty) {
+                    UTL_diag(dec->pos, "dec var(%s), type(%s) not defined",
+                            SYM_get_name(name), SYM_get_name(type));
+                } else if (!TY_match(init_tyir.type, type_ty)) {
+                    printt("type", type_ty);
+                    printt("init", init_tyir.type);
+                    UTL_diag(dec->pos, "dec var(%s), type not match",
+                            SYM_get_name(name));
+                }
+            }
 
-    // translate function bodies
-    for (f = funcs; f; f = f->tail) {
-        AST_dec       dec   = f->head;
-        SYM_symbol    fname = dec->u.func.name;
-        AST_para_list paras = dec->u.func.paras;
-        AST_exp       body  = dec->u.func.body;
+            SYM_enter(venv, name, init_tyir.type);
+            return;
+        }
 
-        TY_type       func     = SYM_look(venv, fname);
-        TY_type_list  para_tys = func->u.func.paras;
-        SMT_tyir      body_tyir;
+        case AST_kind_dec_func: {
+            AST_para_list paras = dec->u.func.paras;
+            TY_type       func;
+            TY_type_list  t;
+            int           k;
 
-        AST_para_list p;
-        TY_type_list  t;
+            // translate function body, in a scope of its own.
+            if (f->step > 0) {
+                SYM_end(venv);
+                return;
+            }
+
+            func = SYM_look(venv, dec->u.func.name);
+
+            SYM_begin(venv);
+
+            for (k = 0, t = func->u.func.paras; k < AST_LEN(paras) && t;
+                 k++, t = t->tail) {
+                SYM_symbol name = paras->items[k]->name;
+                TY_type   type = t->head;
 
-        SYM_begin(venv);
+                SYM_enter(venv, name, type);
+            }
 
-        for (p = paras, t = para_tys; p && t; p = p->tail, t = t->tail) {
-            SYM_symbol name = p->head->name;
-            TY_type   type = t->head;
+            if (SMT_cur()->func_hook &&
+                SMT_cur()->func_hook(dec, SYM_snapshot(venv),
+                                     SYM_snapshot(tenv))) {
+                SYM_end(venv);
+                return;
+            }
 
-            SYM_enter(venv, name, type);
+            SMT_push(w, VIS_exp, dec->u.func.body, 0);
+            return;
         }
-        body_tyir = SMT_trans_exp(venv, tenv, body, 0); // do nothing
 
-        SYM_end(venv);
+        default:
+            UTL_error(dec->pos, "unkown declaration");
     }
 }
 
-static SMT_tyir SMT_trans_exp(SYM_table venv, SYM_table tenv, AST_exp n, int loop)
+static void SMT_step_exp(VIS_walk w, VIS_frame *f, SMT_env *env)
 {
+    SYM_table  venv = env->venv;
+    SYM_table  tenv = env->tenv;
+    AST_exp    n    = f->node;
+    SMT_local *l    = VIS_local(f);
+    int        step = f->step;
+    int        loop = l->loop;
+    SMT_tyir   done = { NULL, NULL };
+
+    // result of child just done, step counts children done.
+    if (step > 0)
+        done = SMT_done(w);
+
     switch(n->kind) {
         case AST_kind_exp_var:
-            return SMT_trans_var(venv, tenv, n->u.var);
+            if (step == 0) {
+                SMT_push(w, VIS_var, n->u.var, 0);
+                return;
+            }
+
+            l->tyir = done;
+            return;
 
         case AST_kind_exp_nil:
-            return SMT_mk_tyir(NULL, TY_nil());
+            l->tyir = SMT_mk_tyir(NULL, TY_nil());
+            return;
 
         case AST_kind_exp_int:
-            return SMT_mk_tyir(NULL, TY_int());
+            l->tyir = SMT_mk_tyir(NULL, TY_int());
+            return;
 
         case AST_kind_exp_str:
-            return SMT_mk_tyir(NULL, TY_str());
+            l->tyir = SMT_mk_tyir(NULL, TY_str());
+            return;
 
         case AST_kind_exp_call: {
             SYM_symbol   func = n->u.call.func;
             AST_exp_list args = n->u.call.args;
-
-            TY_type      func_ty, ret_ty;
             TY_type_list para_tys;
 
             // check funtion.
-            func_ty = SYM_look(venv, func);
-            if (!func_ty) {
-                UTL_error(n->pos, "exp call, func(%s) not defined",
-                        SYM_get_name(func));
-            }
+            if (step == 0) {
+                TY_type func_ty = SYM_look(venv, func);
 
-            ret_ty = func_ty->u.func.ret;
-
-            // check parameter type.
-            para_tys = func_ty->u.func.paras;
-            for (; args && para_tys; args     = args->tail,
-                                    para_tys = para_tys->tail) {
-                AST_exp  arg    = args->head;
-                TY_type para_ty = para_tys->head;
-                SMT_tyir arg_tyir;
-
-                arg_tyir = SMT_trans_exp(venv, tenv, arg, loop);
-                if (!TY_match(para_ty, arg_tyir.type)) {
-                    printt("para", para_ty);
-                    printt("arg", arg_tyir.type);
-                    UTL_error(n->pos,
+                if (!func_ty || TY_get_kind(func_ty) != TY_kind_func) {
+                    UTL_diag(n->pos, func_ty ? "exp call, (%s) is not func"
+                                             : "exp call, func(%s) not defined",
+                            SYM_get_name(func));
+
+                    // arguments are still checked on their own.
+                    l->bad = true;
+                } else {
+                    l->t = func_ty;
+                    l->p = func_ty->u.func.paras;
+                }
+            } else if (!l->bad) {
+                // check parameter type.
+                para_tys = l->p;
+                if (!TY_match(para_tys->head, done.type)) {
+                    printt("para", para_tys->head);
+                    printt("arg", done.type);
+                    UTL_diag(n->pos,
                             "exp call, func(%s), para and arg not match",
                             SYM_get_name(func));
                 }
+                l->p = para_tys->tail;
             }
 
-            return SMT_mk_tyir(NULL, ret_ty);
+            if (step < AST_LEN(args) && (l->bad || l->p)) {
+                SMT_push(w, VIS_exp, args->items[step], loop);
+                return;
+            }
+
+            l->tyir = SMT_mk_tyir(NULL, l->bad ? TY_poison()
+                                               : l->t->u.func.ret);
+            return;
         }
 
         case AST_kind_exp_op: {
-            AST_exp  left  = n->u.op.left;
-            AST_exp  right = n->u.op.right;
-            SMT_tyir left_tyir, right_tyir;
-
-            // check left operand
-            left_tyir = SMT_trans_exp(venv, tenv, left, loop);
-            if (TY_get_kind(left_tyir.type) != TY_kind_int) {
-                printt("left", left_tyir.type);
-                UTL_error(left->pos, "exp op, left is not integer");
-            }
+            AST_exp left  = n->u.op.left;
+            AST_exp right = n->u.op.right;
+
+            switch(step) {
+                case 0:
+                    SMT_push(w, VIS_exp, left, loop);
+                    return;
+
+                case 1:
+                    // check left operand
+                    if (!SMT_is(done.type, TY_kind_int)) {
+                        printt("left", done.type);
+                        UTL_diag(left->pos, "exp op, left is not integer");
+                    }
 
-            // check right operand
-            right_tyir = SMT_trans_exp(venv, tenv, right, loop);
-            if (TY_get_kind(right_tyir.type) != TY_kind_int) {
-                printt("right", right_tyir.type);
-                UTL_error(right->pos, "exp op, right is not integer");
-            }
+                    SMT_push(w, VIS_exp, right, loop);
+                    return;
+
+                default:
+                    // check right operand
+                    if (!SMT_is(done.type, TY_kind_int)) {
+                        printt("right", done.type);
+                        UTL_diag(right->pos, "exp op, right is not integer");
+                    }
 
-            return SMT_mk_tyir(NULL, TY_int());
+                    l->tyir = SMT_mk_tyir(NULL, TY_int());
+                    return;
+            }
         }
 
         case AST_kind_exp_array: {
@@ -389,211 +591,324 @@ static SMT_tyir SMT_trans_exp(SYM_table venv, SYM_table tenv, AST_exp n, int loo
             AST_exp    size  = n->u.array.size;
             AST_exp    init  = n->u.array.init;
             TY_type    array_ty;
-            SMT_tyir   size_tyir, init_tyir;
-
-            // check array type.
-            array_ty = SYM_look(tenv, array);
-            if (!array_ty)
-                UTL_error(n->pos, "exp array(%s), not defined",
-                        SYM_get_name(array));
-
-            if (TY_get_kind(array_ty) != TY_kind_array) {
-                printt("array", array_ty);
-                UTL_error(n->pos, "exp array(%s), is not array",
-                        SYM_get_name(array));
-            }
 
-            // check array size.
-            size_tyir = SMT_trans_exp(venv, tenv, size, loop);
-            if (TY_get_kind(size_tyir.type) != TY_kind_int) {
-                printt("array", size_tyir.type);
-                UTL_error(size->pos, "exp array(%s), size is not integer",
-                        SYM_get_name(array));
-            }
+            switch(step) {
+                case 0:
+                    // check array type.
+                    array_ty = SYM_look(tenv, array);
+                    if (!array_ty) {
+                        UTL_diag(n->pos, "exp array(%s), not defined",
+                                SYM_get_name(array));
+                        array_ty = TY_poison();
+                    } else if (!SMT_is(array_ty, TY_kind_array)) {
+                        printt("array", array_ty);
+                        UTL_diag(n->pos, "exp array(%s), is not array",
+                                SYM_get_name(array));
+                        array_ty = TY_poison();
+                    }
 
-            // check array init.
-            init_tyir = SMT_trans_exp(venv, tenv, init, loop);
-            if (init_tyir.type != array_ty->u.array) {
-                printt("element", array_ty->u.array);
-                printt("init", init_tyir.type);
-                UTL_error(init->pos,
-                        "exp array(%s), element and init not match",
-                        SYM_get_name(array));
-            }
+                    l->t = array_ty;
+                    SMT_push(w, VIS_exp, size, loop);
+                    return;
+
+                case 1:
+                    // check array size.
+                    if (!SMT_is(done.type, TY_kind_int)) {
+                        printt("array", done.type);
+                        UTL_diag(size->pos,
+                                "exp array(%s), size is not integer",
+                                SYM_get_name(array));
+                    }
 
-            return SMT_mk_tyir(NULL, array_ty);
+                    // check array init.
+                    SMT_push(w, VIS_exp, init, loop);
+                    return;
+
+                default:
+                    array_ty = l->t;
+                    l->tyir  = SMT_mk_tyir(NULL, array_ty);
+                    if (TY_get_kind(array_ty) == TY_kind_poison)
+                        return;
+
+                    if (done.type != array_ty->u.array &&
+                        TY_get_kind(done.type) != TY_kind_poison &&
+                        TY_get_kind(array_ty->u.array) != TY_kind_poison) {
+                        printt("element", array_ty->u.array);
+                        printt("init", done.type);
+                        UTL_diag(init->pos,
+                                "exp array(%s), element and init not match",
+                                SYM_get_name(array));
+                    }
+                    return;
+            }
         }
 
         case AST_kind_exp_record: {
             SYM_symbol    record = n->u.record.type;
             AST_arg_list  args   = n->u.record.args;
-            TY_type       record_ty;
             TY_field_list fields;
 
             // check record type.
-            record_ty = SYM_look(tenv, record);
-            if (!record_ty) {
-                UTL_error(n->pos, "exp record(%s), not defined",
-                        SYM_get_name(record));
-            }
-            fields = record_ty->u.record;
-
-            // check fields type.
-            for (; args && fields; args = args->tail, fields = fields->tail) {
-                SYM_symbol name1 = args->head->name;
-                AST_exp    exp   = args->head->exp;
-                SYM_symbol name2 = fields->head->name;
-                TY_type    type  = fields->head->type;
-                SMT_tyir   exp_tyir;
-
-                if (name1 != name2) {
-                    UTL_error(exp->pos, "exp record(%s), name not match"
-                            "give %s, nedd %s", SYM_get_name(record),
-                            SYM_get_name(name1), SYM_get_name(name2));
+            if (step == 0) {
+                TY_type record_ty = SYM_look(tenv, record);
+
+                if (!record_ty || TY_get_kind(record_ty) != TY_kind_record) {
+                    if (!record_ty || TY_get_kind(record_ty) != TY_kind_poison)
+                        UTL_diag(n->pos,
+                                record_ty ? "exp record(%s), is not record"
+                                          : "exp record(%s), not defined",
+                                SYM_get_name(record));
+
+                    // fields are still checked on their own.
+                    l->bad = true;
+                } else {
+                    l->t = record_ty;
+                    l->p = record_ty->u.record;
                 }
-
-                exp_tyir = SMT_trans_exp(venv, tenv, exp, loop);
-                if (!TY_match(type, exp_tyir.type)) {
-                    printt("give", exp_tyir.type);
+            } else if (!l->bad) {
+                AST_exp exp  = args->items[step - 1]->exp;
+                TY_type type;
+
+                // check field type.
+                fields = l->p;
+                type   = fields->head->type;
+                if (!TY_match(type, done.type)) {
+                    printt("give", done.type);
                     printt("need", type);
-                    UTL_error(exp->pos, "exp record(%s), type not match",
+                    UTL_diag(exp->pos, "exp record(%s), type not match",
                             SYM_get_name(record));
                 }
+                l->p = fields->tail;
             }
 
-            return SMT_mk_tyir(NULL, record_ty);
+            if (step < AST_LEN(args) && (l->bad || l->p)) {
+                SYM_symbol name1 = args->items[step]->name;
+                AST_exp    exp   = args->items[step]->exp;
+
+                // check field name.
+                fields = l->p;
+                if (!l->bad && name1 != fields->head->name) {
+                    UTL_diag(exp->pos, "exp record(%s), name not match"
+                            "give %s, nedd %s", SYM_get_name(record),
+                            SYM_get_name(name1),
+                            SYM_get_name(fields->head->name));
+                }
+
+                SMT_push(w, VIS_exp, exp, loop);
+                return;
+            }
+
+            l->tyir = SMT_mk_tyir(NULL, l->bad ? TY_poison() : l->t);
+            return;
         }
 
         case AST_kind_exp_seq: {
             AST_exp_list seq = n->u.seq;
-            SMT_tyir     exp_tyir;
-            AST_exp_list s;
-
-            for (s = seq; s; s = s->tail)
-                exp_tyir = SMT_trans_exp(venv, tenv, s->head, loop);
 
-            return SMT_mk_tyir(NULL, seq ? exp_tyir.type : TY_void());
-        }
+            if (step > 0)
+                l->keep = done;
 
-        case AST_kind_exp_assign: {
-            AST_var  var = n->u.assign.var;
-            AST_exp  exp = n->u.assign.exp;
-            SMT_tyir var_tyir, exp_tyir;
-
-            // check type match.
-            var_tyir = SMT_trans_var(venv, tenv, var);
-            exp_tyir = SMT_trans_exp(venv, tenv, exp, loop);
-            if (!TY_match(var_tyir.type, exp_tyir.type)) {
-                printt("var", var_tyir.type);
-                printt("exp", exp_tyir.type);
-                UTL_error(n->pos, "exp assign, type not match");
+            if (step < AST_LEN(seq)) {
+                SMT_push(w, VIS_exp, seq->items[step], loop);
+                return;
             }
 
-            return SMT_mk_tyir(NULL, TY_void());
+            l->tyir = SMT_mk_tyir(NULL, seq ? l->keep.type : TY_void());
+            return;
         }
 
+        case AST_kind_exp_assign:
+            switch(step) {
+                case 0:
+                    SMT_push(w, VIS_var, n->u.assign.var, 0);
+                    return;
+
+                case 1:
+                    l->keep = done;
+                    SMT_push(w, VIS_exp, n->u.assign.exp, loop);
+                    return;
+
+                default:
+                    // check type match.
+                    if (!TY_match(l->keep.type, done.type)) {
+                        printt("var", l->keep.type);
+                        printt("exp", done.type);
+                        UTL_diag(n->pos, "exp assign, type not match");
+                    }
+
+                    l->tyir = SMT_mk_tyir(NULL, TY_void());
+                    return;
+            }
+
         case AST_kind_exp_if: {
             AST_exp  cond  = n->u.if_.cond;
-            AST_exp  then  = n->u.if_.then;
             AST_exp  else_ = n->u.if_.else_;
-            SMT_tyir cond_tyir, then_tyir, else_tyir;
+            SMT_tyir then_tyir;
+
+            switch(step) {
+                case 0:
+                    SMT_push(w, VIS_exp, cond, loop);
+                    return;
+
+                case 1:
+                    // check condition type.
+                    if (!SMT_is(done.type, TY_kind_int)) {
+                        printt("cond", done.type);
+                        UTL_diag(cond->pos, "exp if, cond is not integer");
+                    }
 
-            // check condition type.
-            cond_tyir = SMT_trans_exp(venv, tenv, cond, loop);
-            if (TY_get_kind(cond_tyir.type) != TY_kind_int) {
-                printt("cond", cond_tyir.type);
-                UTL_error(cond->pos, "exp if, cond is not integer");
-            }
+                    // if-then
+                    SMT_push(w, VIS_exp, n->u.if_.then, loop);
+                    return;
 
-            // if-then
-            then_tyir = SMT_trans_exp(venv, tenv, then, loop);
-            if (!else_)
-                return SMT_mk_tyir(NULL, TY_void());
-
-            // if-then-else, check branches type.
-            else_tyir = SMT_trans_exp(venv, tenv, else_, loop);
-            if (then_tyir.type != else_tyir.type) {
-                printt("then", then_tyir.type);
-                printt("else", else_tyir.type);
-                UTL_error(n->pos, "exp if, branches type not match");
-            }
+                case 2:
+                    if (!else_) {
+                        l->tyir = SMT_mk_tyir(NULL, TY_void());
+                        return;
+                    }
+
+                    // if-then-else
+                    l->keep = done;
+                    SMT_push(w, VIS_exp, else_, loop);
+                    return;
+
+                default:
+                    // check branches type.
+                    then_tyir = l->keep;
+                    if (TY_get_kind(then_tyir.type) == TY_kind_poison) {
+                        l->tyir = SMT_mk_tyir(NULL, done.type);
+                        return;
+                    }
 
-            return SMT_mk_tyir(NULL, then_tyir.type);
+                    if (then_tyir.type != done.type &&
+                        TY_get_kind(done.type) != TY_kind_poison) {
+                        printt("then", then_tyir.type);
+                        printt("else", done.type);
+                        UTL_diag(n->pos, "exp if, branches type not match");
+                    }
+
+                    l->tyir = SMT_mk_tyir(NULL, then_tyir.type);
+                    return;
+            }
         }
 
         case AST_kind_exp_while: {
-            AST_exp  cond = n->u.while_.cond;
-            AST_exp  body = n->u.while_.body;
-            SMT_tyir cond_tyir, body_tyir;
-
-            // check condition type.
-            cond_tyir = SMT_trans_exp(venv, tenv, cond, loop);
-            if (TY_get_kind(cond_tyir.type) != TY_kind_int) {
-                printt("cond", cond_tyir.type);
-                UTL_error(cond->pos, "exp while, cond is not integer");
-            }
+            AST_exp cond = n->u.while_.cond;
+
+            switch(step) {
+                case 0:
+                    SMT_push(w, VIS_exp, cond, loop);
+                    return;
+
+                case 1:
+                    // check condition type.
+                    if (!SMT_is(done.type, TY_kind_int)) {
+                        printt("cond", done.type);
+                        UTL_diag(cond->pos, "exp while, cond is not integer");
+                    }
 
-            SYM_begin(venv);
-            body_tyir = SMT_trans_exp(venv, tenv, body, loop + 1);
-            SYM_end(venv);
+                    SYM_begin(venv);
+                    SMT_push(w, VIS_exp, n->u.while_.body, loop + 1);
+                    return;
 
-            return SMT_mk_tyir(NULL, TY_void());
+                default:
+                    SYM_end(venv);
+
+                    l->tyir = SMT_mk_tyir(NULL, TY_void());
+                    return;
+            }
         }
 
         case AST_kind_exp_for: {
-            SYM_symbol var  = n->u.for_.var;
-            AST_exp    lo   = n->u.for_.lo;
-            AST_exp    hi   = n->u.for_.hi;
-            AST_exp    body = n->u.for_.body;
-            SMT_tyir   lo_tyir, hi_tyir, body_tyir;
-
-            // check lowest exp type.
-            lo_tyir = SMT_trans_exp(venv, tenv, lo, loop);
-            if (TY_get_kind(lo_tyir.type) != TY_kind_int) {
-                printt("low", lo_tyir.type);
-                UTL_error(lo->pos, "exp for, low is not integer");
-            }
+            AST_exp lo = n->u.for_.lo;
+            AST_exp hi = n->u.for_.hi;
+
+            switch(step) {
+                case 0:
+                    SMT_push(w, VIS_exp, lo, loop);
+                    return;
+
+                case 1:
+                    // check lowest exp type.
+                    if (!SMT_is(done.type, TY_kind_int)) {
+                        printt("low", done.type);
+                        UTL_diag(lo->pos, "exp for, low is not integer");
+                    }
 
-            // check highest exp type.
-            hi_tyir = SMT_trans_exp(venv, tenv, hi, loop);
-            if (TY_get_kind(hi_tyir.type) != TY_kind_int) {
-                printt("high", hi_tyir.type);
-                UTL_error(hi->pos, "exp for, high is not integer");
-            }
+                    SMT_push(w, VIS_exp, hi, loop);
+                    return;
 
-            SYM_begin(venv);
-            SYM_enter(venv, var, TY_int());
+                case 2:
+                    // check highest exp type.
+                    if (!SMT_is(done.type, TY_kind_int)) {
+                        printt("high", done.type);
+                        UTL_diag(hi->pos, "exp for, high is not integer");
+                    }
 
-            body_tyir = SMT_trans_exp(venv, tenv, body, loop + 1);
+                    SYM_begin(venv);
+                    SYM_enter(venv, n->u.for_.var, TY_int());
 
-            SYM_end(venv);
+                    SMT_push(w, VIS_exp, n->u.for_.body, loop + 1);
+                    return;
+
+                default:
+                    SYM_end(venv);
 
-            return SMT_mk_tyir(NULL, body_tyir.type);
+                    l->tyir = SMT_mk_tyir(NULL, done.type);
+                    return;
+            }
         }
 
         case AST_kind_exp_break:
             if (loop <= 0)
-                UTL_error(n->pos, "exp break, not in loop");
+                UTL_diag(n->pos, "exp break, not in loop");
 
-            return SMT_mk_tyir(NULL, TY_void());
+            l->tyir = SMT_mk_tyir(NULL, TY_void());
+            return;
 
         case AST_kind_exp_let: {
             AST_dec_list decs = n->u.let.decs;
             AST_exp_list body = n->u.let.body;
-            SMT_tyir     body_tyir;
-            AST_exp_list b;
 
-            SYM_begin(venv);
-            SYM_begin(tenv);
+            if (step == 0) {
+                SYM_begin(venv);
+                SYM_begin(tenv);
+
+                l->p = SMT_trans_types(tenv, decs);
+            } else if (l->phase == SMT_let_body) {
+                l->keep = done;
+            }
 
-            SMT_trans_dec(venv, tenv, decs);
-            for (b = body; b; b = b->tail)
-                body_tyir = SMT_trans_exp(venv, tenv, b->head, loop);
+            // variables, then function heads and bodies.
+            if (l->phase == SMT_let_vars) {
+                if (SMT_next_dec(w, decs, &l->i, AST_kind_dec_var))
+                    return;
+
+                SMT_trans_heads(venv, tenv, decs);
+                l->phase = SMT_let_funcs;
+                l->i     = 0;
+            }
+
+            if (l->phase == SMT_let_funcs) {
+                if (SMT_next_dec(w, decs, &l->i, AST_kind_dec_func))
+                    return;
+
+                // dummy list is not needed any more
+                TY_free_type_list(l->p);
+                l->phase = SMT_let_body;
+                l->i     = 0;
+            }
+
+            if (l->i < AST_LEN(body)) {
+                SMT_push(w, VIS_exp, body->items[l->i++], loop);
+                return;
+            }
 
             SYM_end(tenv);
             SYM_end(venv);
 
-            return SMT_mk_tyir(NULL, body? body_tyir.type : TY_void());
+            l->tyir = SMT_mk_tyir(NULL, body ? l->keep.type : TY_void());
+            return;
         }
 
         default:
@@ -601,63 +916,90 @@ static SMT_tyir SMT_trans_exp(SYM_table venv, SYM_table tenv, AST_exp n, int loo
     }
 }
 
-static SMT_tyir SMT_trans_var(SYM_table venv, SYM_table tenv, AST_var n)
+static void SMT_step_var(VIS_walk w, VIS_frame *f, SMT_env *env)
 {
-    SYM_symbol base;
-    AST_var    suffix;
-    TY_type    base_ty;
-    SMT_tyir   var_tyir;
+    AST_var    n = f->node;
+    SMT_local *l = VIS_local(f);
     AST_var    p;
     TY_type    t;
 
-    if (n->kind != AST_kind_var_base)
-        UTL_error(n->pos, "lvalue, emtpy");
+    if (f->step == 0) {
+        SYM_symbol base;
+        TY_type    base_ty;
 
-    // check symbol.
-    base    = n->u.base.name;
-    suffix  = n->u.base.suffix;
-    base_ty = SYM_look(venv, base);
-    if (!base_ty)
-        UTL_error(n->pos, "lvalue, base(%s) not defined", SYM_get_name(base));
+        if (n->kind != AST_kind_var_base)
+            UTL_error(n->pos, "lvalue, emtpy");
 
-    for (p = suffix, t = base_ty; p;) {
-        switch(suffix->kind) {
-            case AST_kind_var_base:
-                UTL_error(suffix->pos, "lvalue, two bases?");
+        // check symbol.
+        base    = n->u.base.name;
+        base_ty = SYM_look(env->venv, base);
+        if (!base_ty) {
+            UTL_diag(n->pos, "lvalue, base(%s) not defined",
+                    SYM_get_name(base));
+            base_ty = TY_poison();
+        }
 
-            case AST_kind_var_index: {
-                AST_exp  exp      = p->u.index.exp;
-                AST_var  suffix   = p->u.index.suffix;
-                SMT_tyir exp_tyir = SMT_trans_exp(venv, tenv, exp, 0);
+        l->p = n->u.base.suffix;
+        l->t = base_ty;
+    } else {
+        SMT_tyir exp_tyir = SMT_done(w);
 
-                // check array type.
-                if (TY_get_kind(t) != TY_kind_array) {
-                    printt("array", t);
-                    UTL_error(suffix->pos, "lvalue, base is not array");
-                }
+        // index exp is done, p is its index.
+        p = l->p;
+        t = l->t;
 
-                // check index type.
-                if (TY_get_kind(exp_tyir.type) != TY_kind_int) {
-                    printt("index", exp_tyir.type);
-                    UTL_error(suffix->pos, "lvalue, index is not integer");
-                }
+        // check index type.
+        if (!SMT_is(exp_tyir.type, TY_kind_int)) {
+            printt("index", exp_tyir.type);
+            UTL_diag(p->pos, "lvalue, index is not integer");
+        }
 
-                // update.
-                p = suffix;
-                t = t->u.array;
-                break;
-            }
+        // check array type.
+        if (TY_get_kind(t) == TY_kind_poison) {
+            ;
+        } else if (TY_get_kind(t) != TY_kind_array) {
+            printt("array", t);
+            UTL_diag(p->pos, "lvalue, base is not array");
+            t = TY_poison();
+        } else {
+            t = t->u.array;
+        }
+
+        // update.
+        l->p = p->u.index.suffix;
+        l->t = t;
+    }
+
+    // a poisoned base takes its suffixes along, only indexes are checked.
+    for (p = l->p, t = l->t; p;) {
+        switch(p->kind) {
+            case AST_kind_var_base:
+                UTL_error(p->pos, "lvalue, two bases?");
+                return;
+
+            case AST_kind_var_index:
+                l->p = p;
+                l->t = t;
+                SMT_push(w, VIS_exp, p->u.index.exp, 0);
+                return;
 
             case AST_kind_var_field: {
                 SYM_symbol    name   = p->u.field.name;
-                AST_var       suffix = p->u.index.suffix;
+                AST_var       suffix = p->u.field.suffix;
                 TY_field_list fields;
                 TY_field      field;
 
                 // check record type.
+                if (TY_get_kind(t) == TY_kind_poison) {
+                    p = suffix;
+                    break;
+                }
                 if (TY_get_kind(t) != TY_kind_record) {
                     printt("record", t);
-                    UTL_error(suffix->pos, "lvalue, base is not record");
+                    UTL_diag(p->pos, "lvalue, base is not record");
+                    t = TY_poison();
+                    p = suffix;
+                    break;
                 }
 
                 // check field name.
@@ -668,9 +1010,13 @@ static SMT_tyir SMT_trans_var(SYM_table venv, SYM_table tenv, AST_var n)
                         break;
                     }
                 }
-                if (!field)
-                    UTL_error(suffix->pos, "lvalue, field(%s) not defined",
+                if (!field) {
+                    UTL_diag(p->pos, "lvalue, field(%s) not defined",
                             SYM_get_name(name));
+                    t = TY_poison();
+                    p = suffix;
+                    break;
+                }
 
                 // update.
                 p = suffix;
@@ -683,7 +1029,7 @@ static SMT_tyir SMT_trans_var(SYM_table venv, SYM_table tenv, AST_var n)
         }
     }
 
-    return SMT_mk_tyir(NULL, t);
+    l->tyir = SMT_mk_tyir(NULL, t);
 }
 
 static TY_type SMT_trans_type(SYM_table tenv, AST_type n)
@@ -696,8 +1042,9 @@ static TY_type SMT_trans_type(SYM_table tenv, AST_type n)
             // check type name.
             name_ty = SYM_look(tenv, name);
             if(!name_ty) {
-                UTL_error(n->pos, "type name(%s), not defined",
+                UTL_diag(n->pos, "type name(%s), not defined",
                         SYM_get_name(name));
+                name_ty = TY_poison();
             }
 
             return name_ty;
@@ -710,8 +1057,9 @@ static TY_type SMT_trans_type(SYM_table tenv, AST_type n)
             // check element type name.
             element_ty = SYM_look(tenv, element);
             if(!element_ty) {
-                UTL_error(n->pos, "type array, element(%s) not defined",
+                UTL_diag(n->pos, "type array, element(%s) not defined",
                         SYM_get_name(element));
+                element_ty = TY_poison();
             }
 
             return TY_mk_array(element_ty);
@@ -721,20 +1069,21 @@ static TY_type SMT_trans_type(SYM_table tenv, AST_type n)
             AST_para_list record = n->u.record;
             TY_field_list fields;
 
-            AST_para_list p;
             TY_field_list f;
+            int           i;
 
             // make field list.
-            for (p = record, fields = NULL; p; p = p->tail) {
-                SYM_symbol name = p->head->name;
-                SYM_symbol type = p->head->type;
+            for (i = 0, fields = NULL; i < AST_LEN(record); i++) {
+                SYM_symbol name = record->items[i]->name;
+                SYM_symbol type = record->items[i]->type;
                 TY_type    type_ty;
                 TY_field   field;
 
                 type_ty = SYM_look(tenv, type);
                 if (!type_ty) {
-                    UTL_error(n->pos, "type record, field(%s) not defined",
+                    UTL_diag(n->pos, "type record, field(%s) not defined",
                             SYM_get_name(type));
+                    type_ty = TY_poison();
                 }
 
                 field = TY_mk_field(name, type_ty);
@@ -753,6 +1102,8 @@ static TY_type SMT_trans_type(SYM_table tenv, AST_type n)
         default:
             UTL_error(n->pos, "unkown type definition");
     }
+
+    return NULL;
 }
 
 void SMT_trans(AST_exp root)
@@ -760,5 +1111,16 @@ void SMT_trans(AST_exp root)
     SYM_table venv = ENV_base_venv();
     SYM_table tenv = ENV_base_tenv();
 
-    SMT_trans_exp(venv, tenv, root, 0);
+    SMT_check(venv, tenv, VIS_exp, root);
+}
+
+void SMT_on_func(SMT_func_hook hook)
+{
+    SMT_cur()->func_hook = hook;
+}
+
+void SMT_trans_func(AST_dec func, SYM_snap venv, SYM_snap tenv)
+{
+    SMT_check(SYM_empty_snap(venv), SYM_empty_snap(tenv), VIS_exp,
+              func->u.func.body);
 }
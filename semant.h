@@ -5,6 +5,20 @@
  ****************************************************************************/
 
 #include "ast.h"
+#include "symbol.h"
+
+/****************************************************************************
+ * Definitions
+ ****************************************************************************/
+
+/**
+ * @brief Called before checking each function body.
+ *
+ * venv and tenv are snapshots of environments with parameters entered,
+ * they can be kept and given back to SMT_trans_func(). A hook that checked
+ * the body itself returns true, then the body is not checked again.
+ */
+typedef bool (*SMT_func_hook)(AST_dec func, SYM_snap venv, SYM_snap tenv);
 
 /****************************************************************************
  * Public: semantic check fucntions
@@ -16,3 +30,17 @@
  * @return check result.
  */
 void SMT_trans(AST_exp root);
+
+/**
+ * set hook called before checking each function body.
+ * @param[in] hook  NULL to disable, then no snapshot is taken.
+ */
+void SMT_on_func(SMT_func_hook hook);
+
+/**
+ * semantic check on one function body again, incrementally.
+ * @param[in] func  function declaration astnode.
+ * @param[in] venv  value environment snapshot given to hook.
+ * @param[in] tenv  type environment snapshot given to hook.
+ */
+void SMT_trans_func(AST_dec func, SYM_snap venv, SYM_snap tenv);
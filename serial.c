@@ -0,0 +1,998 @@
+/****************************************************************************
+ * Includes
+ ****************************************************************************/
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "serial.h"
+#include "symbol.h"
+#include "util.h"
+#include "visit.h"
+
+/****************************************************************************
+ * Definitions
+ ****************************************************************************/
+
+#define SER_MAGIC       "TAST"
+#define SER_VERSION     1
+#define SER_MIN_SIZE    256     /*< first buffer size, in elements */
+
+typedef enum {
+    SER_class_exp = 1,
+    SER_class_dec,
+    SER_class_var,
+    SER_class_type,
+    SER_class_para,
+    SER_class_arg,
+    SER_class_list,
+} SER_class;
+
+typedef struct {
+    char        magic[4];
+    uint32_t    version;
+    uint32_t    src_size;   /*< text the tree was parsed from */
+    uint32_t    src_hash;
+    uint32_t    nstr;       /*< strings */
+    uint32_t    str_size;   /*< string bytes, padded to a word */
+    uint32_t    nword;      /*< node words */
+    uint32_t    root;       /*< root record + 1, 0 if none */
+} SER_header;
+
+struct SER_image_
+{
+    const SER_header *  head;
+    const uint32_t *    offs;   /*< string offsets */
+    const char *        strs;
+    const uint32_t *    words;  /*< nodes */
+    size_t              maplen;
+};
+
+/* Growing array of words or bytes. */
+typedef struct {
+    void *  data;
+    int     n;
+    int     cap;
+} SER_buf;
+
+typedef struct {
+    SER_buf     words;  /*< uint32_t, nodes */
+    SER_buf     stack;  /*< int, list elements being written */
+    SER_buf     offs;   /*< uint32_t, string offsets */
+    SER_buf     strs;   /*< char, string bytes */
+    SYM_side    syms;   /*< symbol to string index */
+    int         root;   /*< record of root, -1 if none */
+} SER_writer;
+
+/* Locals of a frame being written. */
+typedef struct {
+    int     at;         /*< record written */
+    int     slot;       /*< child slots passed */
+    int     kids[3];    /*< record of each slot of a node, -1 if absent */
+    int     base;       /*< writer stack of a list */
+} SER_local;
+
+typedef struct {
+    SER_image   img;
+    SYM_symbol *syms;   /*< declared on first use */
+    uint8_t *   start;  /*< words beginning a record, one bit each */
+    uint8_t *   seen;   /*< records linked already, one bit each */
+    void **     nodes;  /*< node or list made of record, by its first word */
+    bool        bad;
+} SER_loader;
+
+/****************************************************************************
+ * Private Functions: writer
+ ****************************************************************************/
+
+/**
+ * @brief Make room for n more elements.
+ */
+static void *SER_grow(SER_buf *b, int n, int size)
+{
+    if (b->n + n > b->cap) {
+        int cap = b->cap ? b->cap : SER_MIN_SIZE;
+
+        while (cap < b->n + n)
+            cap *= 2;
+
+        b->data = realloc(b->data, (size_t)cap * size);
+        if (!b->data)
+            UTL_error(UTL_NOPOS, "run out of memory");
+        b->cap = cap;
+    }
+
+    return (char *)b->data + (size_t)b->n * size;
+}
+
+static inline void SER_emit(SER_writer *w, uint32_t word)
+{
+    *(uint32_t *)SER_grow(&w->words, 1, sizeof(uint32_t)) = word;
+    w->words.n++;
+}
+
+/**
+ * @brief Start a record, return its word index.
+ */
+static inline int SER_begin(SER_writer *w, SER_class class, int kind)
+{
+    int at = w->words.n;
+
+    SER_emit(w, class << 8 | kind);
+    return at;
+}
+
+/**
+ * @brief Link from record at to child, child is -1 for NULL.
+ */
+static inline void SER_link(SER_writer *w, int at, int child)
+{
+    SER_emit(w, child < 0 ? 0 : (uint32_t)(child - at));
+}
+
+/**
+ * @brief Add string to table, return its 1-based index.
+ */
+static uint32_t SER_string(SER_writer *w, const char *s)
+{
+    int len = strlen(s) + 1;
+
+    *(uint32_t *)SER_grow(&w->offs, 1, sizeof(uint32_t)) = w->strs.n;
+    memcpy(SER_grow(&w->strs, len, 1), s, len);
+    w->strs.n += len;
+
+    return ++w->offs.n;
+}
+
+/**
+ * @brief Index of symbol name, each symbol is stored once.
+ */
+static uint32_t SER_symbol(SER_writer *w, SYM_symbol s)
+{
+    uintptr_t i;
+
+    if (!s)
+        return 0;
+
+    i = (uintptr_t)SYM_side_get(w->syms, s);
+    if (!i) {
+        i = SER_string(w, SYM_get_name(s));
+        SYM_side_set(w->syms, s, (void *)i);
+    }
+
+    return i;
+}
+
+static inline void SER_push(SER_writer *w, int at)
+{
+    *(int *)SER_grow(&w->stack, 1, sizeof(int)) = at;
+    w->stack.n++;
+}
+
+/**
+ * @brief Write list of elements pushed since base.
+ */
+static int SER_put_exp(SER_writer *w, AST_exp n, const int *kids);
+
+static int SER_put_list(SER_writer *w, SER_class class, int base)
+{
+    int *items = (int *)w->stack.data + base;
+    int i, n = w->stack.n - base, at;
+
+    at = SER_begin(w, SER_class_list, class);
+    SER_emit(w, n);
+    for (i = 0; i < n; i++)
+        SER_link(w, at, items[i]);
+
+    w->stack.n = base;
+    return at;
+}
+
+/**
+ * @brief Write record of a node, its children are written already.
+ *
+ * @param[in] kids  Record of each child slot, -1 if absent.
+ * @return int      Record written.
+ */
+static int SER_put_node(SER_writer *w, VIS_class class, void *node,
+                        const int *kids)
+{
+    int at;
+
+    switch (class) {
+        case VIS_exp:
+            return SER_put_exp(w, node, kids);
+
+        case VIS_dec: {
+            AST_dec n = node;
+
+            at = SER_begin(w, SER_class_dec, n->kind);
+            SER_emit(w, n->pos);
+            switch (n->kind) {
+                case AST_kind_dec_var:
+                    SER_emit(w, SER_symbol(w, n->u.var.name));
+                    SER_emit(w, SER_symbol(w, n->u.var.type));
+                    SER_link(w, at, kids[0]);
+                    SER_emit(w, n->u.var.escape);
+                    break;
+
+                case AST_kind_dec_type:
+                    SER_emit(w, SER_symbol(w, n->u.type.name));
+                    SER_link(w, at, kids[0]);
+                    break;
+
+                case AST_kind_dec_func:
+                    SER_emit(w, SER_symbol(w, n->u.func.name));
+                    SER_emit(w, SER_symbol(w, n->u.func.ret));
+                    SER_link(w, at, kids[0]);
+                    SER_link(w, at, kids[1]);
+                    break;
+
+                default:
+                    UTL_error(n->pos, "unkown dec kind(%d)", n->kind);
+            }
+            return at;
+        }
+
+        case VIS_var: {
+            AST_var n = node;
+
+            at = SER_begin(w, SER_class_var, n->kind);
+            SER_emit(w, n->pos);
+            switch (n->kind) {
+                case AST_kind_var_base:
+                    SER_emit(w, SER_symbol(w, n->u.base.name));
+                    SER_link(w, at, kids[0]);
+                    break;
+
+                case AST_kind_var_index:
+                    SER_link(w, at, kids[0]);
+                    SER_link(w, at, kids[1]);
+                    break;
+
+                case AST_kind_var_field:
+                    SER_emit(w, SER_symbol(w, n->u.field.name));
+                    SER_link(w, at, kids[0]);
+                    break;
+
+                default:
+                    UTL_error(n->pos, "unkown var kind(%d)", n->kind);
+            }
+            return at;
+        }
+
+        case VIS_type: {
+            AST_type n = node;
+
+            at = SER_begin(w, SER_class_type, n->kind);
+            SER_emit(w, n->pos);
+            switch (n->kind) {
+                case AST_kind_type_name:
+                    SER_emit(w, SER_symbol(w, n->u.name));
+                    break;
+
+                case AST_kind_type_array:
+                    SER_emit(w, SER_symbol(w, n->u.array));
+                    break;
+
+                case AST_kind_type_record:
+                    SER_link(w, at, kids[0]);
+                    break;
+            }
+            return at;
+        }
+
+        case VIS_para: {
+            AST_para p = node;
+
+            at = SER_begin(w, SER_class_para, 0);
+            SER_emit(w, p->pos);
+            SER_emit(w, SER_symbol(w, p->name));
+            SER_emit(w, SER_symbol(w, p->type));
+            SER_emit(w, p->escape);
+            return at;
+        }
+
+        case VIS_arg:
+            at = SER_begin(w, SER_class_arg, 0);
+            SER_emit(w, SER_symbol(w, ((AST_arg)node)->name));
+            SER_link(w, at, kids[0]);
+            return at;
+
+        default:
+            UTL_error(UTL_NOPOS, "unkown node to write");
+            return -1;
+    }
+}
+
+static int SER_put_exp(SER_writer *w, AST_exp n, const int *kids)
+{
+    int at, a = kids[0], b = kids[1], c = kids[2];
+
+    at = SER_begin(w, SER_class_exp, n->kind);
+    SER_emit(w, n->pos);
+    switch (n->kind) {
+        case AST_kind_exp_nil:
+        case AST_kind_exp_break:
+            break;
+
+        case AST_kind_exp_int:
+            SER_emit(w, n->u.int_);
+            break;
+
+        case AST_kind_exp_str:
+            SER_emit(w, SER_string(w, n->u.str_));
+            break;
+
+        case AST_kind_exp_op:
+            SER_emit(w, n->u.op.oper);
+            SER_link(w, at, a);
+            SER_link(w, at, b);
+            break;
+
+        case AST_kind_exp_call:
+            SER_emit(w, SER_symbol(w, n->u.call.func));
+            SER_link(w, at, a);
+            break;
+
+        case AST_kind_exp_array:
+            SER_emit(w, SER_symbol(w, n->u.array.type));
+            SER_link(w, at, a);
+            SER_link(w, at, b);
+            break;
+
+        case AST_kind_exp_record:
+            SER_emit(w, SER_symbol(w, n->u.record.type));
+            SER_link(w, at, a);
+            break;
+
+        case AST_kind_exp_for:
+            SER_emit(w, SER_symbol(w, n->u.for_.var));
+            SER_emit(w, n->u.for_.escape);
+            SER_link(w, at, a);
+            SER_link(w, at, b);
+            SER_link(w, at, c);
+            break;
+
+        case AST_kind_exp_var:
+        case AST_kind_exp_seq:
+            SER_link(w, at, a);
+            break;
+
+        case AST_kind_exp_assign:
+        case AST_kind_exp_while:
+        case AST_kind_exp_let:
+            SER_link(w, at, a);
+            SER_link(w, at, b);
+            break;
+
+        case AST_kind_exp_if:
+            SER_link(w, at, a);
+            SER_link(w, at, b);
+            SER_link(w, at, c);
+            break;
+
+        default:
+            UTL_error(n->pos, "unkown exp kind(%d)", n->kind);
+    }
+
+    return at;
+}
+
+/**
+ * @brief Keep record of child slot just passed, a list element is pushed.
+ */
+static inline void SER_keep(SER_writer *w, SER_local *l, bool list, int at)
+{
+    if (list)
+        SER_push(w, at);
+    else
+        l->kids[l->slot - 1] = at;
+}
+
+/* Children first, records link back to them. Elements of a list wait on
+ * the writer stack until the list is written.
+ */
+static void SER_put_step(VIS_walk w, VIS_frame *f, void *ctx)
+{
+    static const SER_class elems[] = {
+        [VIS_exp_list]  = SER_class_exp,
+        [VIS_dec_list]  = SER_class_dec,
+        [VIS_para_list] = SER_class_para,
+        [VIS_arg_list]  = SER_class_arg,
+    };
+    SER_writer *sw   = ctx;
+    SER_local  *l    = VIS_local(f);
+    bool        list = f->class >= VIS_exp_list;
+    VIS_class   class;
+    void *      child;
+
+    if (f->step == 0)
+        l->base = sw->stack.n;
+    else
+        SER_keep(sw, l, list, ((SER_local *)VIS_done(w))->at);
+
+    // absent children are -1, f is stale once a child is pushed.
+    while (VIS_slot(f->class, f->node, l->slot, &class, &child)) {
+        l->slot++;
+        if (child) {
+            VIS_push(w, class, child);
+            return;
+        }
+        SER_keep(sw, l, list, -1);
+    }
+
+    l->at = list ? SER_put_list(sw, elems[f->class], l->base)
+                 : SER_put_node(sw, f->class, f->node, l->kids);
+    if (!VIS_up(w))
+        sw->root = l->at;
+}
+
+/****************************************************************************
+ * Private Functions: loader
+ ****************************************************************************/
+
+/**
+ * @brief Hash of source text, FNV-1a.
+ */
+static uint32_t SER_hash(SRC_source src)
+{
+    const unsigned char *s = (const unsigned char *)SRC_text(src);
+    const unsigned char *e = s + SRC_size(src);
+    uint32_t hash = 2166136261u;
+
+    while (s < e) {
+        hash ^= *s++;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+/**
+ * @brief Word i of nodes, 0 and image marked bad if out of range.
+ */
+static inline uint32_t SER_word(SER_loader *l, int at, int i)
+{
+    if ((unsigned)at + i >= l->img->head->nword) {
+        l->bad = true;
+        return 0;
+    }
+
+    return l->img->words[at + i];
+}
+
+/**
+ * @brief Follow link in word i of record at to a record of class.
+ *
+ * Links point backwards and each record is linked once, so loading ends
+ * and the tree stays a tree whatever the image holds.
+ *
+ * @return int  Child record, -1 if NULL or bad.
+ */
+static int SER_follow(SER_loader *l, int at, int i, SER_class class,
+                      bool optional)
+{
+    int32_t off = (int32_t)SER_word(l, at, i);
+    int child;
+
+    if (!off && optional)
+        return -1;
+
+    if (off >= 0 || off < -at) {
+        l->bad = true;
+        return -1;
+    }
+
+    child = at + off;
+    if (!(l->start[child >> 3] & (1 << (child & 7)))
+        || l->seen[child >> 3] & (1 << (child & 7))
+        || l->img->words[child] >> 8 != class) {
+        l->bad = true;
+        return -1;
+    }
+
+    l->seen[child >> 3] |= 1 << (child & 7);
+    return child;
+}
+
+static const char *SER_str(SER_loader *l, uint32_t i)
+{
+    if (!i || i > l->img->head->nstr) {
+        l->bad = true;
+        return "";
+    }
+
+    return l->img->strs + l->img->offs[i - 1];
+}
+
+static SYM_symbol SER_sym(SER_loader *l, uint32_t i, bool optional)
+{
+    if (!i && optional)
+        return NULL;
+
+    if (!i || i > l->img->head->nstr) {
+        l->bad = true;
+        return NULL;
+    }
+
+    if (!l->syms[i - 1])
+        l->syms[i - 1] = SYM_declare(SER_str(l, i));
+
+    return l->syms[i - 1];
+}
+
+/**
+ * @brief Node or list made of record linked from word i of record at.
+ *
+ * @return void*    NULL if link is NULL or bad.
+ */
+static inline void *SER_kid(SER_loader *l, int at, int i, SER_class class,
+                            bool optional)
+{
+    int child = SER_follow(l, at, i, class, optional);
+
+    return child < 0 ? NULL : l->nodes[child];
+}
+
+/**
+ * @brief List linked from word i of record at, checked to hold class.
+ */
+static void *SER_kid_list(SER_loader *l, int at, int i, SER_class class)
+{
+    int child = SER_follow(l, at, i, SER_class_list, true);
+
+    if (child < 0)
+        return NULL;
+
+    if ((l->img->words[child] & 0xff) != class) {
+        l->bad = true;
+        return NULL;
+    }
+
+    return l->nodes[child];
+}
+
+/* Record at is made into a node or list, each returns words it takes. */
+
+static int SER_get_list(SER_loader *l, int at)
+{
+    void *list = NULL;
+    int i, n = SER_word(l, at, 1);
+    AST_arg arg;
+
+    if (n < 0 || (unsigned)n > l->img->head->nword - at - 2) {
+        l->bad = true;
+        return 0;
+    }
+
+    for (i = 0; i < n && !l->bad; i++) {
+        switch (l->img->words[at] & 0xff) {
+            case SER_class_exp:
+                list = AST_push_exp(list,
+                        SER_kid(l, at, 2 + i, SER_class_exp, false));
+                break;
+
+            case SER_class_dec:
+                list = AST_push_dec(list,
+                        SER_kid(l, at, 2 + i, SER_class_dec, false));
+                break;
+
+            case SER_class_para:
+                list = AST_push_para(list,
+                        SER_kid(l, at, 2 + i, SER_class_para, false));
+                break;
+
+            case SER_class_arg:
+                arg = SER_kid(l, at, 2 + i, SER_class_arg, false);
+                if (arg)
+                    list = AST_push_arg(list, arg);
+                break;
+
+            default:
+                l->bad = true;
+        }
+    }
+
+    l->nodes[at] = list;
+    return 2 + n;
+}
+
+static int SER_get_arg(SER_loader *l, int at)
+{
+    l->nodes[at] = AST_mk_arg(SER_sym(l, SER_word(l, at, 1), false),
+                              SER_kid(l, at, 2, SER_class_exp, false));
+    return 3;
+}
+
+static int SER_get_para(SER_loader *l, int at)
+{
+    AST_para p = AST_mk_para(SER_word(l, at, 1),
+                             SER_sym(l, SER_word(l, at, 2), false),
+                             SER_sym(l, SER_word(l, at, 3), false));
+
+    p->escape    = SER_word(l, at, 4);
+    l->nodes[at] = p;
+    return 5;
+}
+
+static int SER_get_var(SER_loader *l, int at)
+{
+    Apos pos = SER_word(l, at, 1);
+
+    switch (SER_word(l, at, 0) & 0xff) {
+        case AST_kind_var_base:
+            l->nodes[at] = AST_mk_var_base(pos,
+                    SER_sym(l, SER_word(l, at, 2), false),
+                    SER_kid(l, at, 3, SER_class_var, true));
+            return 4;
+
+        case AST_kind_var_index:
+            l->nodes[at] = AST_mk_var_index(pos,
+                    SER_kid(l, at, 2, SER_class_exp, false),
+                    SER_kid(l, at, 3, SER_class_var, true));
+            return 4;
+
+        case AST_kind_var_field:
+            l->nodes[at] = AST_mk_var_field(pos,
+                    SER_sym(l, SER_word(l, at, 2), false),
+                    SER_kid(l, at, 3, SER_class_var, true));
+            return 4;
+    }
+
+    l->bad = true;
+    return 0;
+}
+
+static int SER_get_type(SER_loader *l, int at)
+{
+    Apos pos = SER_word(l, at, 1);
+
+    switch (SER_word(l, at, 0) & 0xff) {
+        case AST_kind_type_name:
+            l->nodes[at] = AST_mk_type_name(pos,
+                    SER_sym(l, SER_word(l, at, 2), false));
+            return 3;
+
+        case AST_kind_type_array:
+            l->nodes[at] = AST_mk_type_array(pos,
+                    SER_sym(l, SER_word(l, at, 2), false));
+            return 3;
+
+        case AST_kind_type_record:
+            l->nodes[at] = AST_mk_type_record(pos,
+                    SER_kid_list(l, at, 2, SER_class_para));
+            return 3;
+    }
+
+    l->bad = true;
+    return 0;
+}
+
+static int SER_get_dec(SER_loader *l, int at)
+{
+    Apos pos = SER_word(l, at, 1);
+    AST_dec d;
+
+    switch (SER_word(l, at, 0) & 0xff) {
+        case AST_kind_dec_var:
+            d = AST_mk_dec_var(pos, SER_sym(l, SER_word(l, at, 2), false),
+                               SER_sym(l, SER_word(l, at, 3), true),
+                               SER_kid(l, at, 4, SER_class_exp, false));
+            d->u.var.escape = SER_word(l, at, 5);
+            l->nodes[at] = d;
+            return 6;
+
+        case AST_kind_dec_type:
+            l->nodes[at] = AST_mk_dec_type(pos,
+                    SER_sym(l, SER_word(l, at, 2), false),
+                    SER_kid(l, at, 3, SER_class_type, false));
+            return 4;
+
+        case AST_kind_dec_func:
+            l->nodes[at] = AST_mk_dec_func(pos,
+                    SER_sym(l, SER_word(l, at, 2), false),
+                    SER_kid_list(l, at, 4, SER_class_para),
+                    SER_sym(l, SER_word(l, at, 3), true),
+                    SER_kid(l, at, 5, SER_class_exp, false));
+            return 6;
+    }
+
+    l->bad = true;
+    return 0;
+}
+
+/* Follow child links of expression record at, word i on. */
+#define SER_EXP(i)      SER_kid(l, at, i, SER_class_exp, false)
+#define SER_EXP_OPT(i)  SER_kid(l, at, i, SER_class_exp, true)
+#define SER_VAR(i)      SER_kid(l, at, i, SER_class_var, false)
+#define SER_SYM(i)      SER_sym(l, SER_word(l, at, i), false)
+
+static int SER_get_exp(SER_loader *l, int at)
+{
+    Apos pos = SER_word(l, at, 1);
+    AST_exp e;
+
+    switch (SER_word(l, at, 0) & 0xff) {
+        case AST_kind_exp_var:
+            l->nodes[at] = AST_mk_exp_var(pos, SER_VAR(2));
+            return 3;
+
+        case AST_kind_exp_nil:
+            l->nodes[at] = AST_mk_exp_nil(pos);
+            return 2;
+
+        case AST_kind_exp_int:
+            l->nodes[at] = AST_mk_exp_int(pos, (int32_t)SER_word(l, at, 2));
+            return 3;
+
+        case AST_kind_exp_str:
+            l->nodes[at] = AST_mk_exp_str(pos, SER_str(l, SER_word(l, at, 2)));
+            return 3;
+
+        case AST_kind_exp_call:
+            l->nodes[at] = AST_mk_exp_call(pos, SER_SYM(2),
+                    SER_kid_list(l, at, 3, SER_class_exp));
+            return 4;
+
+        case AST_kind_exp_op:
+            if (SER_word(l, at, 2) > AST_kind_op_ge)
+                l->bad = true;
+            l->nodes[at] = AST_mk_exp_op(pos, SER_word(l, at, 2), SER_EXP(3),
+                                         SER_EXP(4));
+            return 5;
+
+        case AST_kind_exp_array:
+            l->nodes[at] = AST_mk_exp_array(pos, SER_SYM(2), SER_EXP(3),
+                                            SER_EXP(4));
+            return 5;
+
+        case AST_kind_exp_record:
+            l->nodes[at] = AST_mk_exp_record(pos, SER_SYM(2),
+                    SER_kid_list(l, at, 3, SER_class_arg));
+            return 4;
+
+        case AST_kind_exp_seq:
+            l->nodes[at] = AST_mk_exp_seq(pos,
+                    SER_kid_list(l, at, 2, SER_class_exp));
+            return 3;
+
+        case AST_kind_exp_assign:
+            l->nodes[at] = AST_mk_exp_assign(pos, SER_VAR(2), SER_EXP(3));
+            return 4;
+
+        case AST_kind_exp_if:
+            l->nodes[at] = AST_mk_exp_if(pos, SER_EXP(2), SER_EXP(3),
+                                         SER_EXP_OPT(4));
+            return 5;
+
+        case AST_kind_exp_while:
+            l->nodes[at] = AST_mk_exp_while(pos, SER_EXP(2), SER_EXP(3));
+            return 4;
+
+        case AST_kind_exp_for:
+            e = AST_mk_exp_for(pos, SER_SYM(2), SER_EXP(4), SER_EXP(5),
+                               SER_EXP(6));
+            e->u.for_.escape = SER_word(l, at, 3);
+            l->nodes[at] = e;
+            return 7;
+
+        case AST_kind_exp_break:
+            l->nodes[at] = AST_mk_exp_break(pos);
+            return 2;
+
+        case AST_kind_exp_let:
+            l->nodes[at] = AST_mk_exp_let(pos,
+                    SER_kid_list(l, at, 2, SER_class_dec),
+                    SER_kid_list(l, at, 3, SER_class_exp));
+            return 4;
+    }
+
+    l->bad = true;
+    return 0;
+}
+
+#undef SER_EXP
+#undef SER_EXP_OPT
+#undef SER_VAR
+#undef SER_SYM
+
+/**
+ * @brief Make record at, it begins where the one before ends.
+ *
+ * @return int  Words of record, 0 if bad.
+ */
+static int SER_get(SER_loader *l, int at)
+{
+    l->start[at >> 3] |= 1 << (at & 7);
+
+    switch (l->img->words[at] >> 8) {
+        case SER_class_exp:  return SER_get_exp(l, at);
+        case SER_class_dec:  return SER_get_dec(l, at);
+        case SER_class_var:  return SER_get_var(l, at);
+        case SER_class_type: return SER_get_type(l, at);
+        case SER_class_para: return SER_get_para(l, at);
+        case SER_class_arg:  return SER_get_arg(l, at);
+        case SER_class_list: return SER_get_list(l, at);
+    }
+
+    l->bad = true;
+    return 0;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int SER_write(FILE *out, SRC_source src, AST_exp root)
+{
+    SER_writer w = { 0 };
+    SER_header h;
+    int at, ok;
+
+    w.syms = SYM_mk_side();
+    w.root = -1;
+    if (root)
+        VIS_run(VIS_mk_walk(SER_put_step, sizeof(SER_local), &w), VIS_exp,
+                root);
+    at = w.root;
+
+    // pad strings to a word, nodes stay aligned in mapping.
+    memset(SER_grow(&w.strs, 3, 1), 0, 3);
+    w.strs.n = (w.strs.n + 3) & ~3;
+
+    memcpy(h.magic, SER_MAGIC, sizeof(h.magic));
+    h.version  = SER_VERSION;
+    h.src_size = SRC_size(src);
+    h.src_hash = SER_hash(src);
+    h.nstr     = w.offs.n;
+    h.str_size = w.strs.n;
+    h.nword    = w.words.n;
+    h.root     = at + 1;
+
+    ok = fwrite(&h, sizeof(h), 1, out) == 1
+      && fwrite(w.offs.data, sizeof(uint32_t), w.offs.n, out) == (size_t)w.offs.n
+      && fwrite(w.strs.data, 1, w.strs.n, out) == (size_t)w.strs.n
+      && fwrite(w.words.data, sizeof(uint32_t), w.words.n, out) == (size_t)w.words.n;
+
+    free(w.words.data);
+    free(w.stack.data);
+    free(w.offs.data);
+    free(w.strs.data);
+
+    return ok ? 0 : -1;
+}
+
+int SER_save(const char *filename, SRC_source src, AST_exp root)
+{
+    size_t len = strlen(filename);
+    char *tmp = malloc(len + sizeof(".XXXXXX"));
+    FILE *out = NULL;
+    int fd, ret = -1;
+
+    if (!tmp)
+        UTL_error(UTL_NOPOS, "run out of memory");
+
+    memcpy(tmp, filename, len);
+    memcpy(tmp + len, ".XXXXXX", sizeof(".XXXXXX"));
+
+    // mkstemp() makes it private, images are as readable as sources.
+    fd = mkstemp(tmp);
+    if (fd >= 0 && !fchmod(fd, 0644) && (out = fdopen(fd, "wb"))) {
+        ret = SER_write(out, src, root);
+        if (fclose(out) || (!ret && rename(tmp, filename)))
+            ret = -1;
+    } else if (fd >= 0) {
+        close(fd);
+    }
+
+    if (fd >= 0 && ret)
+        unlink(tmp);
+    free(tmp);
+    return ret;
+}
+
+SER_image SER_map(const char *filename, SRC_source src)
+{
+    const SER_header *h;
+    SER_image img;
+    struct stat st;
+    size_t want;
+    uint32_t i;
+    bool ok;
+    void *p;
+    int fd;
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+
+    if (fstat(fd, &st) || !S_ISREG(st.st_mode)
+        || (size_t)st.st_size < sizeof(SER_header)) {
+        close(fd);
+        return NULL;
+    }
+
+    p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        return NULL;
+
+    // sizes are checked one by one, their sum cannot wrap.
+    h    = p;
+    want = sizeof(*h) + (size_t)h->nstr * 4 + h->str_size + (size_t)h->nword * 4;
+    if (memcmp(h->magic, SER_MAGIC, sizeof(h->magic))
+        || h->version != SER_VERSION || h->str_size % 4
+        || want != (size_t)st.st_size || h->root > h->nword
+        || h->nword > INT32_MAX / 2
+        || h->src_size != (uint32_t)SRC_size(src) || h->src_hash != SER_hash(src)) {
+        munmap(p, st.st_size);
+        return NULL;
+    }
+
+    img = malloc(sizeof(*img));
+    if (!img)
+        UTL_error(UTL_NOPOS, "run out of memory");
+    img->head   = h;
+    img->offs   = (const uint32_t *)(h + 1);
+    img->strs   = (const char *)(img->offs + h->nstr);
+    img->words  = (const uint32_t *)(img->strs + h->str_size);
+    img->maplen = st.st_size;
+
+    // last byte is null, so every string ends inside the table.
+    ok = !h->nstr || !img->strs[h->str_size - 1];
+    for (i = 0; ok && i < h->nstr; i++)
+        ok = img->offs[i] < h->str_size;
+
+    if (!ok) {
+        SER_unmap(img);
+        return NULL;
+    }
+
+    return img;
+}
+
+AST_exp SER_load(SER_image img)
+{
+    SER_loader l = { 0 };
+    uint32_t at, len, root = img->head->root;
+    AST_exp tree;
+
+    l.img = img;
+
+    if (!root)
+        return NULL;
+
+    l.syms  = calloc(img->head->nstr + 1, sizeof(*l.syms));
+    l.start = calloc(img->head->nword / 8 + 1, 1);
+    l.seen  = calloc(img->head->nword / 8 + 1, 1);
+    l.nodes = malloc((img->head->nword + 1) * sizeof(*l.nodes));
+    if (!l.syms || !l.start || !l.seen || !l.nodes)
+        UTL_error(UTL_NOPOS, "run out of memory");
+
+    // children come before parents, one pass in order needs no stack.
+    for (at = 0; at < img->head->nword && !l.bad; at += len)
+        len = SER_get(&l, at);
+
+    if (!(l.start[(root - 1) >> 3] & (1 << ((root - 1) & 7)))
+        || img->words[root - 1] >> 8 != SER_class_exp)
+        l.bad = true;
+    tree = l.bad ? NULL : l.nodes[root - 1];
+
+    free(l.syms);
+    free(l.start);
+    free(l.seen);
+    free(l.nodes);
+    return tree;
+}
+
+void SER_unmap(SER_image img)
+{
+    munmap((void *)img->head, img->maplen);
+    free(img);
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+/****************************************************************************
+ * Includes
+ ****************************************************************************/
+
+#include <stdio.h>
+#include "ast.h"
+#include "source.h"
+
+/****************************************************************************
+ * Definitions
+ ****************************************************************************/
+
+/**
+ * @brief Binary ast image, mapped read-only.
+ *
+ * Layout, all words 32-bit in native byte order:
+ *   header    magic "TAST", version, size and hash of the source text,
+ *             string count, string bytes, node words, root.
+ *   offsets   one per string, into string bytes.
+ *   strings   null-terminated, padded with nulls to a word.
+ *   nodes     records of words, children written before parents.
+ *
+ * A record is a tag (class << 8 | kind), then its fields. Symbols and
+ * string literals are 1-based indexes into the string table, 0 is NULL.
+ * Child links are word offsets relative to the record, always negative,
+ * 0 is NULL. Lists are a tag, a count and one link per element.
+ */
+typedef struct SER_image_ *SER_image;
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/**
+ * @brief Write tree as binary image.
+ *
+ * @param[in] out
+ * @param[in] src       Source tree was parsed from, its text is hashed so
+ *                      image is only loaded for the same text.
+ * @param[in] root
+ * @return int  0 on success, -1 if cannot write.
+ */
+int SER_write(FILE *out, SRC_source src, AST_exp root);
+
+/**
+ * @brief Write image to file, replacing it at once.
+ *
+ * Image is written beside filename and renamed over it, so a reader never
+ * maps half a file.
+ *
+ * @param[in] filename
+ * @param[in] src
+ * @param[in] root
+ * @return int  0 on success, -1 if cannot write.
+ */
+int SER_save(const char *filename, SRC_source src, AST_exp root);
+
+/**
+ * @brief Map image file.
+ *
+ * Header and string table are checked here, nodes when loaded.
+ *
+ * @param[in] filename
+ * @param[in] src       Source the image should belong to.
+ * @return SER_image    NULL if missing, of other version or other source.
+ */
+SER_image SER_map(const char *filename, SRC_source src);
+
+/**
+ * @brief Build tree from mapped image.
+ *
+ * Nodes are read straight from the mapping and made in current region,
+ * symbols are declared once each. String literals are not copied, they
+ * point into the mapping, so keep image mapped while tree is in use.
+ * Records can't serve as nodes in place, passes follow pointers and
+ * records link by relative offset, so each one is made into a node.
+ * One pass in file order does it, children come before parents, so
+ * any depth loads without a stack.
+ *
+ * @param[in] img
+ * @return AST_exp  Root, NULL if image is corrupt.
+ */
+AST_exp SER_load(SER_image img);
+
+/**
+ * @brief Unmap image.
+ *
+ * @param[in] img
+ */
+void SER_unmap(SER_image img);
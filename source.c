@@ -0,0 +1,259 @@
+/****************************************************************************
+ * Includes
+ ****************************************************************************/
+
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "source.h"
+#include "util.h"
+
+/****************************************************************************
+ * Definitions
+ ****************************************************************************/
+
+#define SRC_READ_SIZE   (64 * 1024)     /*< first buffer size of non-files */
+#define SRC_LINE_BASE   256             /*< lines in first block */
+#define SRC_LINE_BLOCKS 24              /*< block k holds BASE << k lines */
+
+struct SRC_source_
+{
+    const char *name;
+    char *      text;
+    int         size;   /*< text length */
+    size_t      maplen; /*< bytes mapped, 0 if text is malloced */
+    int *       lines[SRC_LINE_BLOCKS]; /*< line starts, see SRC_line() */
+    atomic_int  nline;  /*< lines recorded, published by lexer */
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/**
+ * @brief Slot of line i.
+ *
+ * Line starts are kept in blocks doubling in size, blocks never move once
+ * allocated, so a reader may search lines already published while lexer
+ * is still recording.
+ */
+static inline int *SRC_line(SRC_source src, int i)
+{
+    unsigned k = 31 - __builtin_clz((unsigned)i / SRC_LINE_BASE + 1);
+
+    return &src->lines[k][i - SRC_LINE_BASE * ((1 << k) - 1)];
+}
+
+/**
+ * @brief Map regular file, with zeros behind it.
+ *
+ * Reserve anonymous (zero) pages for text and 2 nulls, then map the file
+ * over the front. Bytes behind end of file in its last page are zero too.
+ *
+ * @param[in] src
+ * @param[in] fd
+ * @return bool     False if mmap is not possible.
+ */
+static bool SRC_map(SRC_source src, int fd)
+{
+    size_t page = sysconf(_SC_PAGESIZE);
+    char *p;
+
+    src->maplen = (src->size + 2 + page - 1) / page * page;
+
+    p = mmap(NULL, src->maplen, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+        return false;
+
+    if (src->size > 0 && mmap(p, src->size, PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(p, src->maplen);
+        return false;
+    }
+
+    src->text = p;
+    return true;
+}
+
+/**
+ * @brief Read whole stream into memory.
+ *
+ * @param[in] src
+ * @param[in] fd
+ * @return bool     False if out of memory, stream is too large or unreadable.
+ */
+static bool SRC_read(SRC_source src, int fd)
+{
+    size_t cap = SRC_READ_SIZE, size = 0;
+    char *text = malloc(cap), *more;
+    ssize_t n;
+
+    while (text) {
+        // room for 2 nulls behind, length must fit an int.
+        if (size + 2 >= cap) {
+            if (cap > INT32_MAX / 2 || !(more = realloc(text, cap * 2)))
+                break;
+            text = more;
+            cap *= 2;
+        }
+
+        n = read(fd, text + size, cap - size - 2);
+        if (n == 0) {
+            text[size]     = '\0';
+            text[size + 1] = '\0';
+
+            src->maplen = 0;
+            src->size   = size;
+            src->text   = text;
+            return true;
+        }
+        if (n < 0)
+            break;
+        size += n;
+    }
+
+    free(text);
+    return false;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+SRC_source SRC_open(const char *filename)
+{
+    SRC_source src;
+    struct stat st;
+    int fd;
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        UTL_error(UTL_NOPOS, "cannot open %s", filename);
+
+    src = UTL_alloc_in(UTL_region_global, UTL_tag_other, sizeof(*src));
+    src->name = UTL_strpool(filename, strlen(filename));
+    memset(src->lines, 0, sizeof(src->lines));
+    src->lines[0] = malloc(SRC_LINE_BASE * sizeof(src->lines[0][0]));
+    if (!src->lines[0])
+        UTL_error(UTL_NOPOS, "run out of memory");
+    src->lines[0][0] = 0;
+    atomic_init(&src->nline, 1);
+
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size < INT32_MAX
+        && (src->size = st.st_size, SRC_map(src, fd))) {
+        close(fd);
+        return src;
+    }
+
+    if (!SRC_read(src, fd)) {
+        close(fd);
+        UTL_error(UTL_NOPOS, "cannot read %s", filename);
+    }
+    close(fd);
+    return src;
+}
+
+void SRC_close(SRC_source src)
+{
+    int k;
+
+    if (src->maplen)
+        munmap(src->text, src->maplen);
+    else
+        free(src->text);
+
+    for (k = 0; k < SRC_LINE_BLOCKS; k++) {
+        free(src->lines[k]);
+        src->lines[k] = NULL;
+    }
+
+    src->text = NULL;
+    src->size = 0;
+    atomic_store(&src->nline, 0);
+}
+
+char *SRC_text(SRC_source src)
+{
+    return src->text;
+}
+
+int SRC_size(SRC_source src)
+{
+    return src->size;
+}
+
+const char *SRC_name(SRC_source src)
+{
+    return src->name;
+}
+
+void SRC_write(SRC_source src, int pos, int len, FILE *out)
+{
+    if (pos < 0 || pos >= src->size)
+        return;
+
+    if (len > src->size - pos)
+        len = src->size - pos;
+
+    fwrite(src->text + pos, 1, len, out);
+}
+
+void SRC_newline(SRC_source src, int pos)
+{
+    int n = atomic_load_explicit(&src->nline, memory_order_relaxed);
+    unsigned k;
+
+    if (pos < *SRC_line(src, n - 1))
+        return;
+
+    k = 31 - __builtin_clz((unsigned)n / SRC_LINE_BASE + 1);
+    if (!src->lines[k]) {
+        src->lines[k] = malloc((SRC_LINE_BASE << k) * sizeof(int));
+        if (!src->lines[k])
+            UTL_error(UTL_NOPOS, "run out of memory");
+    }
+
+    *SRC_line(src, n) = pos + 1;
+    atomic_store_explicit(&src->nline, n + 1, memory_order_release);
+}
+
+void SRC_scan_lines(SRC_source src)
+{
+    const char *p = src->text, *end = src->text + src->size;
+
+    while ((p = memchr(p, '\n', end - p))) {
+        SRC_newline(src, p - src->text);
+        p++;
+    }
+}
+
+void SRC_locate(SRC_source src, int pos, int *line, int *col)
+{
+    int lo = 0, hi, mid;
+
+    hi = atomic_load_explicit(&src->nline, memory_order_acquire) - 1;
+    if (hi < 0) {
+        *line = 0;
+        *col  = pos + 1;
+        return;
+    }
+
+    // last line starting at or before pos.
+    while (lo < hi) {
+        mid = (lo + hi + 1) / 2;
+        if (*SRC_line(src, mid) <= pos)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+
+    *line = lo + 1;
+    *col  = pos - *SRC_line(src, lo) + 1;
+}
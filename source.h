@@ -0,0 +1,115 @@
+#pragma once
+
+/****************************************************************************
+ * Includes
+ ****************************************************************************/
+
+#include <stdio.h>
+
+/****************************************************************************
+ * Definitions
+ ****************************************************************************/
+
+/**
+ * @brief Source buffer.
+ *
+ * Whole file mapped once, lexer scans it in place, echo and diagnostics
+ * read slices of the same mapping. Text is followed by two null bytes, as
+ * flex yy_scan_buffer() wants.
+ *
+ * Positions are byte offsets into text. Lexer records where lines start
+ * while scanning, line and column are only computed when asked for.
+ */
+typedef struct SRC_source_ *SRC_source;
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/**
+ * @brief Map file.
+ *
+ * Regular files are mmaped privately (copy-on-write, file never changes),
+ * others (pipes, ttys) are read into memory. Exit if cannot open.
+ *
+ * @param[in] filename
+ * @return SRC_source
+ */
+SRC_source SRC_open(const char *filename);
+
+/**
+ * @brief Unmap file.
+ *
+ * @param[in] src
+ */
+void SRC_close(SRC_source src);
+
+/**
+ * @brief Get source text.
+ *
+ * Writable, lexers may put temporary nulls in it.
+ *
+ * @param[in] src
+ * @return char*    Text, followed by two null bytes.
+ */
+char *SRC_text(SRC_source src);
+
+/**
+ * @brief Get source text length, without trailing nulls.
+ *
+ * @param[in] src
+ * @return int
+ */
+int SRC_size(SRC_source src);
+
+/**
+ * @brief Get source file name.
+ *
+ * @param[in] src
+ * @return const char*
+ */
+const char *SRC_name(SRC_source src);
+
+/**
+ * @brief Write slice of text.
+ *
+ * @param[in] src
+ * @param[in] pos   Byte offset.
+ * @param[in] len   Bytes, clipped to end of text.
+ * @param[in] out
+ */
+void SRC_write(SRC_source src, int pos, int len, FILE *out);
+
+/**
+ * @brief Record a newline, called by lexers in scanning order.
+ *
+ * Offsets not behind the last recorded newline are ignored, so scanning
+ * the same source again does no harm. One lexer may record while another
+ * thread calls SRC_locate().
+ *
+ * @param[in] src
+ * @param[in] pos   Byte offset of '\n'.
+ */
+void SRC_newline(SRC_source src, int pos);
+
+/**
+ * @brief Record every newline without lexing.
+ *
+ * For trees not made by scanning this source, e.g. loaded from an image,
+ * so diagnostics still find their lines.
+ *
+ * @param[in] src
+ */
+void SRC_scan_lines(SRC_source src);
+
+/**
+ * @brief Resolve byte offset to line and column, both 1-based.
+ *
+ * Binary search in line starts recorded so far.
+ *
+ * @param[in] src
+ * @param[in] pos   Byte offset.
+ * @param[out] line
+ * @param[out] col
+ */
+void SRC_locate(SRC_source src, int pos, int *line, int *col);
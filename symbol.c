@@ -3,9 +3,11 @@
  ********************************************************************************/
 
 #include <assert.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "context.h"
 #include "symbol.h"
 #include "util.h"
 
@@ -13,65 +15,215 @@
  * Definitions
  ********************************************************************************/
 
-#define SYM_TABLE_SIZE 109
+#define SYM_TABLE_SIZE 256  /*< initial slots, always power of 2 */
+#define SYM_SIDE_SIZE  64   /*< initial side table slots */
+#define SYM_ENV_SIZE   64   /*< initial env tops, binds and scopes */
 
 struct SYM_symbol_
 {
     const char *name;
-    SYM_symbol  next;
+    int         len;    /*< strlen(name) */
+    unsigned    hash;   /*< full hash of name */
+    int         id;     /*< dense id */
 };
 
-/********************************************************************************
- * Private Data
- ********************************************************************************/
+/**
+ * @brief Health statistics of every bind-table.
+ */
+typedef struct SYM_envstat_
+{
+    long    binds;      /*< SYM_enter calls */
+    long    looks;
+    long    misses;     /*< looks found nothing in table */
+    long    pops;       /*< binds undone by SYM_end */
+    int     depth;      /*< deepest scope nesting */
+} SYM_envstat;
+
+/**
+ * @brief Interner of a context, open addressing with linear probing.
+ *
+ * Kept at most half full, grown by doubling.
+ */
+typedef struct SYM_state_
+{
+    SYM_symbol *table;
+    unsigned    cap;        /*< slots */
+    unsigned    cnt;        /*< symbols */
+    long        looks;      /*< SYM_declare calls */
+    long        probes;     /*< slots visited by SYM_declare */
+    SYM_envstat env;
+} SYM_state;
+
+struct SYM_side_
+{
+    void ** values;     /*< indexed by symbol id */
+    int     cap;
+};
 
-static SYM_symbol symtable[SYM_TABLE_SIZE];
+/**
+ * @brief Bind, entry of undo log.
+ */
+struct SYM_bind_
+{
+    SYM_symbol  symbol;
+    void *      value;
+    int         prev;   /*< shadowed bind of same symbol, -1 for none */
+};
 
-static struct SYM_symbol_ sign = { "<scope>", NULL, };
+/**
+ * @brief Scoped environment.
+ *
+ * Binds are pushed to an undo log, binds of the same symbol are chained
+ * from newest to oldest, so each symbol has its own shadow stack whose top
+ * is found by id. A scope remembers the log length at its begin.
+ */
+struct SYM_table_
+{
+    SYM_envstat *       stat;   /*< of context creating the table */
+    SYM_snap            base;   /*< looked when symbol is not bound */
+    bool                track;  /*< keep persistent copy for snapshots */
+    SYM_snap            snap;   /*< persistent copy of visible binds */
+    SYM_snap *          snaps;  /*< snap at each begin, if tracking */
+    int *               tops;   /*< newest bind of each symbol id, or -1 */
+    int                 ntops;
+    struct SYM_bind_ *  binds;  /*< undo log */
+    int                 nbinds, cbinds;
+    int *               scopes; /*< log length at each begin */
+    int                 nscopes, cscopes;
+};
 
 /********************************************************************************
  * Private Functions
  ********************************************************************************/
 
-static inline unsigned BKDRhash(const char *s)
+/**
+ * @brief State of current context.
+ */
+static inline SYM_state *SYM_cur(void)
 {
-    unsigned seed = 131, hash = 0;
+    TIGER_ctx ctx = TIGER_cur();
 
-    while (*s)
-        hash = hash * seed + (*s++);
+    if (__builtin_expect(!ctx->sym, 0))
+        ctx->sym = TIGER_mk_state(sizeof(*ctx->sym));
 
-    return hash % SYM_TABLE_SIZE;
+    return ctx->sym;
 }
 
-static SYM_symbol SYM_mk_symbol(const char *name, SYM_symbol next)
+/**
+ * @brief FNV-1a hash.
+ *
+ * @param[in] s     Bytes.
+ * @param[in] len   Length.
+ * @return unsigned Full 32-bit hash.
+ */
+static inline unsigned SYM_hash_bytes(const char *s, int len)
 {
-    SYM_symbol s = UTL_alloc(sizeof(*s));
+    unsigned hash = 2166136261u;
+
+    while (len-- > 0) {
+        hash ^= (unsigned char)*s++;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+static SYM_symbol SYM_mk_symbol(const char *name, int len, unsigned hash,
+                                int id)
+{
+    SYM_symbol s = UTL_alloc_in(UTL_region_global, UTL_tag_symbol, sizeof(*s));
 
     s->name = name;
-    s->next = next;
+    s->len  = len;
+    s->hash = hash;
+    s->id   = id;
 
     return s;
 }
 
+/**
+ * @brief Grow interner to double slots, rehash with cached hashes.
+ */
+static void SYM_grow(SYM_state *g)
+{
+    SYM_symbol *old = g->table;
+    unsigned    cap = g->cap, i, j;
+
+    g->cap   = cap ? cap * 2 : SYM_TABLE_SIZE;
+    g->table = UTL_alloc_in(UTL_region_global, UTL_tag_symbol,
+                            g->cap * sizeof(*g->table));
+    memset(g->table, 0, g->cap * sizeof(*g->table));
+
+    for (i = 0; i < cap; i++) {
+        if (!old[i])
+            continue;
+
+        for (j = old[i]->hash & (g->cap - 1); g->table[j];
+             j = (j + 1) & (g->cap - 1));
+        g->table[j] = old[i];
+    }
+}
+
+/**
+ * @brief Grow array in current region, old one is left to the region.
+ *
+ * @param[in] p     Array.
+ * @param[in] n     Used elements.
+ * @param[in] cap   New capacity in elements.
+ * @param[in] size  Element size.
+ * @return void*    New array.
+ */
+static void *SYM_grow_array(void *p, int n, int cap, int size)
+{
+    void *q = UTL_alloc_as(UTL_tag_bind, cap * size);
+
+    memcpy(q, p, n * size);
+
+    return q;
+}
+
 /********************************************************************************
  * Public Functions
  ********************************************************************************/
 
 SYM_symbol SYM_declare(const char *name)
 {
-    unsigned index;
-    SYM_symbol head, s;
+    return SYM_declare_n(name, strlen(name));
+}
+
+SYM_symbol SYM_declare_n(const char *name, int len)
+{
+    SYM_state *g = SYM_cur();
+    unsigned hash, index;
+    SYM_symbol s;
 
-    index = BKDRhash(name);
-    head  = symtable[index];
+    if ((g->cnt + 1) * 2 > g->cap)
+        SYM_grow(g);
 
-    for (s = head; s; s = s->next) {
-        if (!strcmp(s->name, name))
+    hash = SYM_hash_bytes(name, len);
+
+    g->looks++;
+    for (index = hash & (g->cap - 1); (s = g->table[index]);
+         index = (index + 1) & (g->cap - 1)) {
+        g->probes++;
+        if (s->hash == hash && s->len == len && !memcmp(s->name, name, len))
             return s; // symbol already exists.
     }
 
-    symtable[index] = SYM_mk_symbol(name, head);
-    return symtable[index];
+    // first time seen, keep bytes in string pool.
+    g->table[index] = SYM_mk_symbol(UTL_strpool(name, len), len, hash,
+                                    g->cnt++);
+    return g->table[index];
+}
+
+int SYM_id(SYM_symbol s)
+{
+    return s->id;
+}
+
+unsigned SYM_hash(void *symbol)
+{
+    return ((SYM_symbol)symbol)->hash;
 }
 
 const char *SYM_get_name(SYM_symbol s)
@@ -79,36 +231,210 @@ const char *SYM_get_name(SYM_symbol s)
     return s->name;
 }
 
+SYM_side SYM_mk_side(void)
+{
+    SYM_side side = UTL_alloc_as(UTL_tag_symbol, sizeof(*side));
+
+    side->values = NULL;
+    side->cap    = 0;
+
+    return side;
+}
+
+void *SYM_side_get(SYM_side side, SYM_symbol s)
+{
+    return s->id < side->cap ? side->values[s->id] : NULL;
+}
+
+void SYM_side_set(SYM_side side, SYM_symbol s, void *value)
+{
+    if (s->id >= side->cap) {
+        int cap = side->cap ? side->cap : SYM_SIDE_SIZE;
+        void **values;
+
+        while (cap <= s->id)
+            cap *= 2;
+
+        values = UTL_alloc_as(UTL_tag_symbol, cap * sizeof(*values));
+        memcpy(values, side->values, side->cap * sizeof(*values));
+        memset(values + side->cap, 0, (cap - side->cap) * sizeof(*values));
+
+        side->values = values;
+        side->cap    = cap;
+    }
+
+    side->values[s->id] = value;
+}
+
 SYM_table SYM_empty(void)
 {
-    return TAB_empty();
+    SYM_table t = UTL_alloc_as(UTL_tag_bind, sizeof(*t));
+
+    memset(t, 0, sizeof(*t));
+    t->stat = &SYM_cur()->env;
+
+    return t;
 }
 
 void SYM_enter(SYM_table t, SYM_symbol s, void *v)
 {
-    return TAB_enter(t, s, v);
+    struct SYM_bind_ *b;
+
+    if (s->id >= t->ntops) {
+        int n = t->ntops ? t->ntops : SYM_ENV_SIZE;
+
+        while (n <= s->id)
+            n *= 2;
+
+        t->tops = SYM_grow_array(t->tops, t->ntops, n, sizeof(*t->tops));
+        memset(t->tops + t->ntops, 0xff, (n - t->ntops) * sizeof(*t->tops));
+        t->ntops = n;
+    }
+
+    if (t->nbinds == t->cbinds) {
+        t->cbinds = t->cbinds ? t->cbinds * 2 : SYM_ENV_SIZE;
+        t->binds  = SYM_grow_array(t->binds, t->nbinds, t->cbinds,
+                                   sizeof(*t->binds));
+    }
+
+    t->stat->binds++;
+
+    b = &t->binds[t->nbinds];
+    b->symbol = s;
+    b->value  = v;
+    b->prev   = t->tops[s->id];
+
+    t->tops[s->id] = t->nbinds++;
+
+    if (t->track)
+        t->snap = HMT_enter(t->snap, s->hash, s, v);
 }
 
 void *SYM_look(SYM_table t, SYM_symbol s)
 {
-    return TAB_look(t, s);
+    int top;
+
+    t->stat->looks++;
+    if (s->id >= t->ntops || (top = t->tops[s->id]) < 0) {
+        t->stat->misses++;
+        return t->base ? SYM_look_snap(t->base, s) : NULL;
+    }
+
+    return t->binds[top].value;
 }
 
 void SYM_begin(SYM_table t)
 {
-    SYM_enter(t, &sign, NULL);
+    if (t->nscopes == t->cscopes) {
+        int n = t->cscopes ? t->cscopes * 2 : SYM_ENV_SIZE;
+
+        t->scopes = SYM_grow_array(t->scopes, t->nscopes, n,
+                                   sizeof(*t->scopes));
+        if (t->track) {
+            t->snaps = SYM_grow_array(t->snaps, t->nscopes, n,
+                                      sizeof(*t->snaps));
+        }
+        t->cscopes = n;
+    }
+
+    if (t->track)
+        t->snaps[t->nscopes] = t->snap;
+    t->scopes[t->nscopes++] = t->nbinds;
+
+    if (t->nscopes > t->stat->depth)
+        t->stat->depth = t->nscopes;
 }
 
 void SYM_end(SYM_table t)
 {
-    SYM_symbol s;
+    int base;
+
+    if (!t->nscopes)
+        UTL_error(UTL_NOPOS, "end scope without begin");
+
+    // undo binds made in this scope only.
+    base = t->scopes[--t->nscopes];
+    t->stat->pops += t->nbinds - base;
+    while (t->nbinds > base) {
+        struct SYM_bind_ *b = &t->binds[--t->nbinds];
+
+        t->tops[b->symbol->id] = b->prev;
+    }
 
-    do {
-        s = TAB_pop(t);
-    } while (s != &sign);
+    if (t->track)
+        t->snap = t->snaps[t->nscopes];
+}
+
+SYM_table SYM_empty_snap(SYM_snap base)
+{
+    SYM_table t = SYM_empty();
+
+    t->base = base;
+    t->snap = base;
+
+    return t;
+}
+
+SYM_snap SYM_snapshot(SYM_table t)
+{
+    int i, k;
+
+    if (t->track)
+        return t->snap;
+
+    /* First snapshot, replay undo log into persistent map, remember map at
+     * each open scope. Later enters keep it up to date.
+     */
+    t->snaps = UTL_alloc_as(UTL_tag_bind, t->cscopes * sizeof(*t->snaps));
+    t->snap  = t->base;
+
+    for (i = 0, k = 0; i <= t->nbinds; i++) {
+        for (; k < t->nscopes && t->scopes[k] == i; k++)
+            t->snaps[k] = t->snap;
+
+        if (i < t->nbinds) {
+            struct SYM_bind_ *b = &t->binds[i];
+
+            t->snap = HMT_enter(t->snap, b->symbol->hash, b->symbol, b->value);
+        }
+    }
+
+    t->track = true;
+    return t->snap;
+}
+
+void *SYM_look_snap(SYM_snap snap, SYM_symbol s)
+{
+    return HMT_look(snap, s->hash, s);
 }
 
 void SYM_dump(SYM_table t, void (*show)(SYM_symbol s, void *v))
 {
-    TAB_dump(t, (void (*)(void *, void *)) show);
-}
\ No newline at end of file
+    int i;
+
+    for (i = t->nbinds - 1; i >= 0; i--)
+        show(t->binds[i].symbol, t->binds[i].value);
+}
+
+void SYM_report(FILE *out)
+{
+    SYM_state *g = SYM_cur();
+    unsigned i, dist, longest = 0;
+
+    // probe length of each symbol is distance from its home slot.
+    for (i = 0; i < g->cap; i++) {
+        if (!g->table[i])
+            continue;
+
+        dist = (i - g->table[i]->hash) & (g->cap - 1);
+        if (dist + 1 > longest)
+            longest = dist + 1;
+    }
+
+    fprintf(out, "interner: %u symbols, %u slots, longest probe %u, "
+            "%ld declares, avg probe %.2f\n", g->cnt, g->cap, longest,
+            g->looks, g->looks ? (double)g->probes / g->looks : 0.0);
+    fprintf(out, "env: %ld binds, %ld looks, %ld misses, %ld pops, "
+            "max scope depth %d\n", g->env.binds, g->env.looks,
+            g->env.misses, g->env.pops, g->env.depth);
+}
@@ -4,6 +4,8 @@
  * Includes
  ****************************************************************************/
 
+#include <stdio.h>
+#include "hamt.h"
 #include "table.h"
 
 /****************************************************************************
@@ -13,11 +15,26 @@
 /**
  * @brief symbol-bind-table
  *
- * Table has <symbol,void*> type.
+ * Scoped environment of <symbol,void*>, each symbol has its own shadow
+ * stack indexed by symbol id, each scope has an undo log.
  */
-typedef TAB_table           SYM_table;
+typedef struct SYM_table_ * SYM_table;
+
+/**
+ * @brief symbol-bind-table snapshot
+ *
+ * Immutable <symbol,void*> map, taking and keeping one is O(1).
+ */
+typedef HMT_map             SYM_snap;
 typedef struct SYM_symbol_ *SYM_symbol;
 
+/**
+ * @brief symbol side table
+ *
+ * Flat <symbol,void*> array indexed by symbol id, no hashing.
+ */
+typedef struct SYM_side_ *  SYM_side;
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -26,12 +43,25 @@ typedef struct SYM_symbol_ *SYM_symbol;
  * @brief Declare existence of symbol.
  *
  * If symbol name exist, return found symbol, otherwise make a new one.
+ * Name is copied to string pool for new symbol, caller keeps its buffer.
  *
  * @param name          Symbol name.
  * @return SYM_symbol   New/Found symbol.
  */
 SYM_symbol SYM_declare(const char *name);
 
+/**
+ * @brief Declare existence of symbol from a slice.
+ *
+ * Same as SYM_declare(), name need not be null-terminated, so symbols can
+ * be interned straight from lexer buffer.
+ *
+ * @param name          Symbol name bytes.
+ * @param len           Name length.
+ * @return SYM_symbol   New/Found symbol.
+ */
+SYM_symbol SYM_declare_n(const char *name, int len);
+
 /**
  * @brief Get symbol name.
  *
@@ -40,6 +70,54 @@ SYM_symbol SYM_declare(const char *name);
  */
 const char *SYM_get_name(SYM_symbol symbol);
 
+/**
+ * @brief Get symbol hash.
+ *
+ * Hash of the name, computed once when symbol is declared. Takes a bare
+ * key, so TAB tables keyed by symbols can use it, see TAB_empty_hash().
+ *
+ * @param symbol
+ * @return unsigned     Full 32-bit hash.
+ */
+unsigned SYM_hash(void *symbol);
+
+/**
+ * @brief Get symbol id.
+ *
+ * Ids are dense and given in declaring order, from 0.
+ *
+ * @param symbol
+ * @return int          Id.
+ */
+int SYM_id(SYM_symbol symbol);
+
+/**
+ * @brief Empty side table constructor.
+ *
+ * Side table grows with ids, alloced in current region.
+ *
+ * @return SYM_side
+ */
+SYM_side SYM_mk_side(void);
+
+/**
+ * @brief Get value attached to symbol.
+ *
+ * @param[in] side
+ * @param[in] symbol
+ * @return void*        Value, NULL if never set.
+ */
+void *SYM_side_get(SYM_side side, SYM_symbol symbol);
+
+/**
+ * @brief Attach value to symbol.
+ *
+ * @param[in] side
+ * @param[in] symbol
+ * @param[in] value
+ */
+void SYM_side_set(SYM_side side, SYM_symbol symbol, void *value);
+
 /**
  * @brief Empty symbol-bind-table constructor.
  *
@@ -59,6 +137,8 @@ void SYM_enter(SYM_table table, SYM_symbol symbol, void *value);
 /**
  * @brief Look(find) a symbol in bind-table.
  *
+ * Array index by symbol id plus top-of-stack read, no hashing.
+ *
  * @param[in] table
  * @param[in] symbol
  * @return void*        Value.
@@ -68,7 +148,7 @@ void *SYM_look(SYM_table table, SYM_symbol symbol);
 /**
  * @brief Begin of scope.
  *
- * Enter an begin sign.
+ * Remember where the undo log is.
  *
  * @param[in] table.
  */
@@ -77,16 +157,59 @@ void SYM_begin(SYM_table table);
 /**
  * @brief End of scope.
  *
- * Pop till previous begin sign.
+ * Undo exactly the binds made since matching begin.
  *
  * @param[in] table.
  */
 void SYM_end(SYM_table table);
 
+/**
+ * @brief Empty symbol-bind-table on top of a snapshot.
+ *
+ * Symbols not bound in table are looked in base.
+ *
+ * @param[in] base      Snapshot.
+ * @return SYM_table.
+ */
+SYM_table SYM_empty_snap(SYM_snap base);
+
+/**
+ * @brief Take snapshot of what is visible in bind-table now.
+ *
+ * First call replays the table into a persistent map, then table keeps
+ * it up to date on enter and end, so later snapshots are O(1). Tables
+ * never snapshotted pay nothing.
+ *
+ * @param[in] table
+ * @return SYM_snap
+ */
+SYM_snap SYM_snapshot(SYM_table table);
+
+/**
+ * @brief Look(find) a symbol in snapshot.
+ *
+ * @param[in] snap
+ * @param[in] symbol
+ * @return void*        Value.
+ */
+void *SYM_look_snap(SYM_snap snap, SYM_symbol symbol);
+
 /**
  * @brief Show content of a bind table.
  *
+ * Newest bind first, shadowed binds are shown too.
+ *
  * @param[in] table.
  * @param[in] show      Display function.
  */
 void SYM_dump(SYM_table table, void (*show)(SYM_symbol s, void *v));
+
+/**
+ * @brief Show interner and bind-table health.
+ *
+ * Interner: symbols, slots, longest and average probe length.
+ * Bind-tables (all of them): binds, looks, misses, pops and deepest scope.
+ *
+ * @param[in] out
+ */
+void SYM_report(FILE *out);
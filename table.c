@@ -2,6 +2,8 @@
  * Includes
  ****************************************************************************/
 
+#include <stdint.h>
+#include <stdio.h>
 #include <string.h>
 #include "table.h"
 #include "util.h"
@@ -26,20 +28,30 @@ struct TAB_table_
 {
     bind table[TABLE_SIZE];
     void *top;
+    unsigned (*hash)(void *key);  /*< key hash, NULL for pointer hash */
+
+    // health statistics
+    int     entries;    /*< binds in table */
+    int     pops;
+    long    looks;
+    long    probes;     /*< binds visited by looks */
 };
 
 /********************************************************************************
  * Private Functions
  ********************************************************************************/
 
-static inline unsigned hash(void *key)
+static inline unsigned hash(TAB_table t, void *key)
 {
-    return ((unsigned)key) % TABLE_SIZE;
+    if (t->hash)
+        return t->hash(key) % TABLE_SIZE;
+
+    return (unsigned)((uintptr_t)key >> 4) % TABLE_SIZE;
 }
 
 static bind TAB_mk_bind(void *key, void* value, bind next, void *prevtop)
 {
-    bind b = UTL_alloc(sizeof(*b));
+    bind b = UTL_pool_alloc(UTL_tag_bind, sizeof(*b));
 
     b->key     = key;
     b->value   = value;
@@ -55,9 +67,15 @@ static bind TAB_mk_bind(void *key, void* value, bind next, void *prevtop)
 
 TAB_table TAB_empty(void)
 {
-    TAB_table t = UTL_alloc(sizeof(*t));
+    return TAB_empty_hash(NULL);
+}
+
+TAB_table TAB_empty_hash(unsigned (*hash)(void *key))
+{
+    TAB_table t = UTL_alloc_as(UTL_tag_bind, sizeof(*t));
 
     memset(t, 0, sizeof(*t));
+    t->hash = hash;
 
     return t;
 }
@@ -71,10 +89,11 @@ void TAB_enter(TAB_table t, void *key, void *value)
     if (!key)
         UTL_error(UTL_NOPOS, "enter null key to table");
 
-    index = hash(key);
+    index = hash(t, key);
 
     t->table[index] = TAB_mk_bind(key, value, t->table[index], t->top);
     t->top          = key;
+    t->entries++;
 }
 
 void *TAB_look(TAB_table t, void *key)
@@ -87,9 +106,11 @@ void *TAB_look(TAB_table t, void *key)
     if (!key)
         UTL_error(UTL_NOPOS, "look null key into table");
 
-    index = hash(key);
+    index = hash(t, key);
 
+    t->looks++;
     for (b = t->table[index]; b; b = b->next) {
+        t->probes++;
         if (b->key == key)
             return b->value;
     }
@@ -110,20 +131,55 @@ void *TAB_pop(TAB_table t)
     if (!key)
         UTL_error(UTL_NOPOS, "pop a top-empty table");
 
-    index = hash(key);
+    index = hash(t, key);
     b     = t->table[index];
     if (!b) // impossible
         UTL_error(UTL_NOPOS, "pop a buggy table");
 
     t->table[index] = b->next;
     t->top          = b->prevtop;
+    t->entries--;
+    t->pops++;
+
+    UTL_pool_free(UTL_tag_bind, b, sizeof(*b));
 
-    return b->key;
+    return key;
 }
 
 void TAB_dump(TAB_table t, void (*show)(void *key, void *value))
 {
-    // ENOSYS
-    (void)t;
-    (void)show;
+    int i;
+    bind b;
+
+    if (!t)
+        UTL_error(UTL_NOPOS, "dump a null table");
+
+    // bucket by bucket, newest bind first.
+    for (i = 0; i < TABLE_SIZE; i++) {
+        for (b = t->table[i]; b; b = b->next)
+            show(b->key, b->value);
+    }
+}
+
+void TAB_report(TAB_table t, FILE *out)
+{
+    int i, n, used = 0, longest = 0;
+    bind b;
+
+    if (!t)
+        UTL_error(UTL_NOPOS, "report a null table");
+
+    for (i = 0; i < TABLE_SIZE; i++) {
+        for (n = 0, b = t->table[i]; b; b = b->next)
+            n++;
+
+        used += n > 0;
+        if (n > longest)
+            longest = n;
+    }
+
+    fprintf(out, "table: %d entries, %d/%d buckets, longest chain %d, "
+            "%ld looks, avg probe %.2f, %d pops\n", t->entries, used,
+            TABLE_SIZE, longest, t->looks,
+            t->looks ? (double)t->probes / t->looks : 0.0, t->pops);
 }
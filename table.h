@@ -1,5 +1,11 @@
 #pragma once
 
+/****************************************************************************
+ * Includes
+ ****************************************************************************/
+
+#include <stdio.h>
+
 /****************************************************************************
  * Definitions
  ****************************************************************************/
@@ -23,6 +29,17 @@ typedef struct TAB_table_ *TAB_table;
  */
 TAB_table TAB_empty(void);
 
+/**
+ * @brief Empty Table constructor with key hash function
+ *
+ * Keys which already carry their hash can avoid the pointer hash, tables
+ * keyed by symbols pass SYM_hash().
+ *
+ * @param[in] hash  Key hash function, NULL for pointer hash.
+ * @return TAB_table
+ */
+TAB_table TAB_empty_hash(unsigned (*hash)(void *key));
+
 /**
  * @brief Enter(push,insert) a key-value pair to table.
  *
@@ -52,7 +69,20 @@ void *TAB_pop(TAB_table table);
 /**
  * @brief Dump(show)
  *
+ * Every bind, bucket by bucket, newest first in each bucket.
+ *
  * @param[in] table
  * @param[in] show  Display Function.
  */
 void TAB_dump(TAB_table table, void (*show)(void *key, void *value));
+
+/**
+ * @brief Show table health.
+ *
+ * Entries, used buckets, longest chain, average binds visited per look
+ * and pops.
+ *
+ * @param[in] table
+ * @param[in] out
+ */
+void TAB_report(TAB_table table, FILE *out);
@@ -2,6 +2,7 @@
  * Includes
  ****************************************************************************/
 
+#include "context.h"
 #include "table.h"
 #include "temp.h"
 #include "util.h"
@@ -15,12 +16,31 @@ struct TMP_temp_list { TMP_temp head;  TMP_temp_list tail; };
 struct TMP_label_list { TMP_label head; TMP_label_list tail; };
 struct TMP_map_ { TAB_table tab; TMP_map under; };
 
+/**
+ * @brief Counters of a context.
+ */
+typedef struct TMP_state_
+{
+    int ntemps;
+    int nlabels;
+} TMP_state;
+
 /****************************************************************************
  * Privates
  ****************************************************************************/
 
-static int ntemps;
-static int nlabels;
+/**
+ * @brief State of current context.
+ */
+static inline TMP_state *TMP_cur(void)
+{
+    TIGER_ctx ctx = TIGER_cur();
+
+    if (__builtin_expect(!ctx->tmp, 0))
+        ctx->tmp = TIGER_mk_state(sizeof(*ctx->tmp));
+
+    return ctx->tmp;
+}
 
 /****************************************************************************
  * Public: temp & label
@@ -28,16 +48,16 @@ static int nlabels;
 
 TMP_temp TMP_mk_temp(void)
 {
-    TMP_temp p = UTL_alloc(sizeof(*p));
+    TMP_temp p = UTL_alloc_as(UTL_tag_temp, sizeof(*p));
 
-    p->index = ntemps++;
+    p->index = TMP_cur()->ntemps++;
 
     return p;
 }
 
 TMP_temp_list TMP_mk_temp_list(TMP_temp head, TMP_temp_list tail)
 {
-    TMP_temp_list p = UTL_alloc(sizeof(*p));
+    TMP_temp_list p = UTL_pool_alloc(UTL_tag_temp, sizeof(*p));
 
     p->head = head;
     p->tail = tail;
@@ -49,7 +69,7 @@ TMP_label TMP_mk_label(void)
 {
     char buf[64];
 
-    snprintf(buf, sizeof(buf), "l%s", nlabels++);
+    snprintf(buf, sizeof(buf), "l%s", TMP_cur()->nlabels++);
 
     return TMP_mk_label_named(buf);
 }
@@ -61,7 +81,7 @@ TMP_label TMP_mk_label_named(const char *name)
 
 TMP_label TMP_mk_label_list(TMP_label head, TMP_label_list tail)
 {
-    TMP_label_list p = UTL_alloc(sizeof(*p));
+    TMP_label_list p = UTL_alloc_as(UTL_tag_temp, sizeof(*p));
 
     p->head = head;
     p->tail = tail;
@@ -80,7 +100,7 @@ TMP_label TMP_get_label_name(TMP_label label)
 
 TMP_map TMP_mk_map(TAB_table tab, TMP_map under)
 {
-    TMP_map m = UTL_alloc(sizeof(*m));
+    TMP_map m = UTL_alloc_as(UTL_tag_temp, sizeof(*m));
 
     m->tab   = tab;
     m->under = under;
@@ -1,42 +1,433 @@
+#include <pthread.h>
+#include <setjmp.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
 #include "ast.h"
+#include "context.h"
+#include "flat.h"
+#include "lexer.h"
+#include "parser.h"
 #include "semant.h"
+#include "serial.h"
+#include "source.h"
+#include "symbol.h"
+#include "token.h"
 #include "type.h"
 #include "util.h"
 
-extern AST_exp AST_root;
-int parse(const char *);
+int parse(SRC_source src, AST_exp *root);
 
-int main(int argc, char **argv) {
+// options and result of compiling one file.
+typedef struct {
+    const char *filename;
+    bool hand;
+    bool batch;
+    bool pipe;
+    bool descent;
+    bool cache;
+    bool flat;
+    bool share;
+    bool recheck;
+    bool trace;
+    bool quiet;
+    AST_dump_format format;
+    bool memory;
+    bool stats;
+    SRC_source src;     // open while compiling
+    TOK_array tokens;   // of a shared tree, kept to parse it again
+    char *text;         // output, if compiled beside other files
+    size_t size;
+    int status;
+} job;
+
+// errors show line:column of the source being compiled.
+static void locate(void *src, int pos, int *line, int *col) {
+    SRC_locate(src, pos, line, col);
+}
+
+// monotonic clock in milliseconds.
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+// lex and parse source with the lexer and parser chosen. a token array
+// of a shared tree is kept, to parse it again unshared from the same.
+static int parse_source(job *j, AST_exp *root, bool again) {
+    FILE *out = TIGER_out();
+    TOK_array tokens = j->tokens;
+    TOK_pipe pipe = NULL;
+    int ret;
+
+    j->tokens = NULL;
+    if (tokens) {
+        TOK_rewind(tokens);
+        LEX_feed(tokens);
+    } else if (j->batch) {
+        tokens = TOK_lex(j->src);
+        if (j->trace)
+            TOK_dump(out, j->src, tokens);
+        LEX_feed(tokens);
+    } else if (j->pipe) {
+        pipe = TOK_start(j->src);
+        LEX_pipe(pipe);
+    } else {
+        LEX_source(j->src);
+    }
+    ret = j->descent ? PAR_parse(j->src, root) : parse(j->src, root);
+    if (tokens) {
+        LEX_feed(NULL);
+        if (j->share && !again)
+            j->tokens = tokens;
+        else
+            TOK_free(tokens);
+    } else if (pipe) {
+        LEX_pipe(NULL);
+        TOK_stop(pipe);
+    } else {
+        LEX_source(NULL);
+    }
+
+    return ret;
+}
+
+// check each function body again from snapshots of its environments,
+// instead of in the environments of the whole program walk.
+static bool recheck(AST_dec func, SYM_snap venv, SYM_snap tenv) {
+    SMT_trans_func(func, venv, tenv);
+    return true;
+}
+
+// check a tree, errors point to where each node is used. shared nodes
+// keep the position of their first use, a shared tree is checked quietly
+// and, if it fails, made again unshared from its image or its tokens and
+// checked for the reports. gives the tree checked last.
+static AST_exp check(job *j, AST_exp root, SER_image img) {
+    SMT_on_func(j->recheck ? recheck : NULL);
+    if (j->share) {
+        UTL_quiet(true);
+        SMT_trans(root);
+        if (!UTL_quiet(false))
+            return root;
+
+        UTL_enter_region(UTL_region_parse);
+        if (!img || !(root = SER_load(img)))
+            parse_source(j, &root, true);
+        UTL_exit_region();
+    }
+
+    SMT_trans(root);
+    return root;
+}
+
+// compile a file in current context, print steps to its output.
+static void compile(job *j) {
     const char *sep = "-----------------------------------------------------";
-    FILE* fp;
-    char ch;
+    FILE *out = TIGER_out();
+    SER_image img = NULL;
+    FLT_tree flat = NULL;
+    char image[4096];
+    AST_exp root = NULL;
+    double start, elapsed;
+    int ret, n;
+
+    j->src = SRC_open(j->filename);
+    UTL_set_locator(locate, j->src);
+
+    UTL_track_tags(j->memory);
+    if (j->hand)
+        LEX_use(LEX_kind_hand);
+
+    fprintf(out, "\n%s\nStep 1. parsing:\n", sep);
+    UTL_enter_region(UTL_region_parse);
+    AST_share(j->share);
+    start = now();
+    if (j->cache) {
+        snprintf(image, sizeof(image), "%s.ast", j->filename);
+        img = SER_map(image, j->src);
+    }
+    if (img && !(root = SER_load(img))) {
+        // corrupt, parse again and replace it.
+        SER_unmap(img);
+        img = NULL;
+    }
+    if (img) {
+        SRC_scan_lines(j->src);
+        ret = 0;
+    } else {
+        ret = parse_source(j, &root, false);
+    }
+    elapsed = now() - start;
+    if (j->stats)
+        fprintf(out, "%s: %.3f ms\n", img ? "load ast" : "lex and parse", elapsed);
+    if (j->stats && j->share)
+        AST_report_share(out);
+    AST_share(false);
+    UTL_report_tags(out, "parse");
+
+    if (ret == 0 && j->flat) {
+        start = now();
+        flat  = FLT_flatten(root);
+        elapsed = now() - start;
+        if (j->stats) {
+            fprintf(out, "flatten: %.3f ms\n", elapsed);
+            FLT_report(out, flat);
+        }
+    }
+    if (ret == 0 && j->stats) {
+        start = now();
+        n = AST_count(root);
+        fprintf(out, "walk pointer ast: %d nodes, %.3f ms\n", n, now() - start);
+        if (flat) {
+            start = now();
+            n = FLT_count(flat);
+            fprintf(out, "walk flat ast: %d nodes, %.3f ms\n", n, now() - start);
+        }
+    }
+
+    // tree of a failed parse has holes, nothing more to check.
+    if (ret == 0 && !j->quiet) {
+        fprintf(out, "\n%s\nStep 2. contrast:\n", sep);
+        SRC_write(j->src, 0, SRC_size(j->src), out);
+
+        fprintf(out, "\n%s\nStep 3. display ast:\n", sep);
+        start = now();
+        if (flat && j->format == AST_dump_tree) {
+            FLT_print(out, flat);
+        } else if (fileno(out) >= 0) {
+            // a real file, stream past stdio.
+            fflush(out);
+            AST_dump_fd(fileno(out), root, j->format);
+        } else {
+            AST_dump(out, root, j->format);
+        }
+        if (j->stats)
+            fprintf(out, "display ast: %.3f ms\n", now() - start);
+    }
+    UTL_exit_region();
+
+    if (ret == 0) {
+        fprintf(out, "\n%s\nStep 4. semantic check:\n", sep);
+        UTL_enter_region(UTL_region_semant);
+        root = check(j, root, img);
+        UTL_exit_region();
+        UTL_report_tags(out, "semant");
+
+        // tree checked last, a shared one keeps wrong positions only if
+        // there was nothing to report.
+        if (j->cache && !img)
+            SER_save(image, j->src, root);
+    }
+    if (j->tokens) {
+        TOK_free(j->tokens);
+        j->tokens = NULL;
+    }
+
+    // ast and environments are useless now
+    UTL_release_region(UTL_region_parse);
+    UTL_release_region(UTL_region_semant);
+    if (flat)
+        FLT_free(flat);
+    if (img)
+        SER_unmap(img);     // string literals of ast were in it
+
+    if (j->memory) {
+        fprintf(out, "\n%s\nmemory:\n", sep);
+        UTL_report_tags(out, "released");
+        UTL_report_regions(out);
+        UTL_report_pools(out);
+    }
 
-    if (argc != 2) {
-        fprintf(stderr, "usage: a.out filename\n");
+    if (j->stats) {
+        fprintf(out, "\n%s\nstatistics:\n", sep);
+        SYM_report(out);
+    }
+
+    // every error is reported, run fails at the end.
+    if (UTL_errors()) {
+        fprintf(out, "\n%s\nfailed, %d errors\n", sep, UTL_errors());
+        j->status = 1;
+    } else {
+        fprintf(out, "\n%s\nsuccess\n", sep);
+    }
+    UTL_set_locator(NULL, NULL);
+    SRC_close(j->src);
+    j->src = NULL;
+}
+
+// compile a file in its own context, output kept in memory.
+static void *compile_thread(void *arg) {
+    job *j = arg;
+    TIGER_ctx ctx;
+    jmp_buf bail;
+    FILE *out;
+
+    out = open_memstream(&j->text, &j->size);
+    if (!out) {
+        j->status = 1;
+        return NULL;
+    }
+
+    ctx = TIGER_mk_ctx();
+    ctx->out  = out;
+    ctx->bail = &bail;
+    TIGER_use(ctx);
+
+    if (setjmp(bail)) {
+        // a lexer thread may still use the context, stop it first.
+        j->status = 1;
+        LEX_abort();
+        if (j->tokens)
+            TOK_free(j->tokens);
+        if (j->src)
+            SRC_close(j->src);
+    } else {
+        compile(j);
+    }
+
+    TIGER_free_ctx(ctx);
+    fclose(out);
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    job opts = { 0 }, *jobs;
+    pthread_t *threads;
+    jmp_buf bail;
+    int i, n, opt, status = 0;
+
+    while ((opt = getopt(argc, argv, "bcd:fhilmpqrst")) != -1) {
+        switch (opt) {
+            case 'b':
+                opts.batch = true;
+                break;
+
+            case 'c':
+                opts.cache = true;
+                break;
+
+            case 'd':
+                if (!strcmp(optarg, "tree")) {
+                    opts.format = AST_dump_tree;
+                } else if (!strcmp(optarg, "compact")) {
+                    opts.format = AST_dump_compact;
+                } else if (!strcmp(optarg, "json")) {
+                    opts.format = AST_dump_json;
+                } else {
+                    fprintf(stderr, "unknown dump format %s, tree, compact or json\n", optarg);
+                    exit(1);
+                }
+                break;
+
+            case 'f':
+                opts.flat = true;
+                break;
+
+            case 'h':
+                opts.share = true;
+                break;
+
+            case 'i':
+                opts.recheck = true;
+                break;
+
+            case 'l':
+                opts.hand = true;
+                break;
+
+            case 'm':
+                opts.memory = true;
+                break;
+
+            case 'p':
+                opts.pipe = true;
+                break;
+
+            case 'q':
+                opts.quiet = true;
+                break;
+
+            case 'r':
+                opts.descent = true;
+                break;
+
+            case 's':
+                opts.stats = true;
+                break;
+
+            case 't':
+                opts.batch = opts.trace = true;
+                break;
+
+            default:
+                fprintf(stderr, "usage: a.out [-b] [-c] [-d format] [-f] [-h] [-i] [-l] [-m] [-p] [-q] [-r] [-s] [-t] file...\n");
+                exit(1);
+        }
+    }
+
+    // tag tracking is not thread safe, a lexer thread can't run beside it.
+    if (opts.memory && opts.pipe) {
+        fprintf(stderr, "-m and -p can't be used together\n");
         exit(1);
     }
 
-    printf("\n%s\nStep 1. parsing:\n", sep);
-    if (parse(argv[1]) != 0)
-        UTL_error(-1, "parse fail");
+    n = argc - optind;
+    if (n < 1) {
+        fprintf(stderr, "usage: a.out [-b] [-c] [-d format] [-f] [-h] [-i] [-l] [-m] [-p] [-q] [-r] [-s] [-t] file...\n");
+        exit(1);
+    }
 
-    printf("\n%s\nStep 2. contrast:\n", sep);
-    fp = fopen(argv[1], "r");
-    if (!fp)
-        UTL_error(-1, "open fail");
-    while((ch = fgetc(fp)) != EOF)
-        putchar(ch);
-    fclose(fp);
+    // single file, compile in default context, stop on error.
+    if (n == 1) {
+        opts.filename = argv[optind];
+        TIGER_cur()->bail = &bail;
+        if (setjmp(bail)) {
+            opts.status = 1;
+            LEX_abort();
+            if (opts.tokens)
+                TOK_free(opts.tokens);
+            if (opts.src)
+                SRC_close(opts.src);
+        } else {
+            compile(&opts);
+        }
+        UTL_free();
+        return opts.status;
+    }
 
-    printf("\n%s\nStep 3. display ast:\n", sep);
-    AST_print(stdout, AST_root);
+    // several files, one context and thread each, outputs shown in order.
+    jobs    = calloc(n, sizeof(*jobs));
+    threads = calloc(n, sizeof(*threads));
+    if (!jobs || !threads) {
+        fprintf(stderr, "run out of memory\n");
+        exit(1);
+    }
+
+    for (i = 0; i < n; i++) {
+        jobs[i] = opts;
+        jobs[i].filename = argv[optind + i];
+        if (pthread_create(&threads[i], NULL, compile_thread, &jobs[i])) {
+            fprintf(stderr, "cannot create thread\n");
+            exit(1);
+        }
+    }
 
-    printf("\n%s\nStep 4. semantic check:\n", sep);
-    SMT_trans(AST_root);
+    for (i = 0; i < n; i++) {
+        pthread_join(threads[i], NULL);
+        printf("\n==> %s <==\n", jobs[i].filename);
+        if (jobs[i].text)
+            fwrite(jobs[i].text, 1, jobs[i].size, stdout);
+        free(jobs[i].text);
+        status |= jobs[i].status;
+    }
 
-    printf("\n%s\nsuccess\n", sep);
-    UTL_free();
-    return 0;
+    free(jobs);
+    free(threads);
+    return status;
 }
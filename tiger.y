@@ -7,47 +7,60 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "ast.h"
+#include "lexer.h"
+#include "source.h"
 #include "symbol.h"
+#include "util.h"
+
+#define yylex LEX_next
+
+// node is located at its first token, empty rule behind previous token.
+#define YYLLOC_DEFAULT(Cur, Rhs, N) \
+    ((Cur) = (N) ? YYRHSLOC(Rhs, 1) : YYRHSLOC(Rhs, 0))
+
+%}
+
+%code requires {
+#include "ast.h"
+#include "source.h"
+}
+
+%code {
 
 /****************************************************************************
  * Public
  ****************************************************************************/
 
-AST_exp AST_root;
-
-extern FILE *yyin;
-int yyparse(void);
-int yylex(void);
-
-void yyerror(char *s)
+void yyerror(YYLTYPE *lloc, SRC_source src, AST_exp *root, const char *s)
 {
-    fprintf(stderr, "Parse error: \"%s\"\n", s);
+    UTL_diag(*lloc, "parse, %s", s);
 }
 
-int parse(const char *filename)
+/* Tokens come from LEX_next(), caller sets up lexer, array or pipe.
+ * Errors are recovered from, the run fails if any was reported.
+ */
+int parse(SRC_source src, AST_exp *root)
 {
-    int ret;
-
-    yyin = fopen(filename, "r");
-    if (!yyin) {
-        fprintf(stderr, "cannot open %s\n", filename);
-        exit(1);
-    }
+    int errors = UTL_errors();
 
-    AST_root = NULL;
-    ret = yyparse();
+    *root = NULL;
+    return yyparse(src, root) || UTL_errors() != errors;
+}
 
-    fclose(yyin);
-    return ret;
 }
 
-%}
+%define api.pure full
+%define parse.error verbose
+%define api.location.type {Apos}
+%locations
+%parse-param {SRC_source src} {AST_exp *root}
 
 %union
 {
     int             pos;
     int             ival;
     const char *    sval;
+    SYM_symbol      sym;
     AST_dec         dec;
     AST_exp         exp;
     AST_var         var;
@@ -61,7 +74,8 @@ int parse(const char *filename)
 }
 
 %token <ival>   INT
-%token <sval>   ID STRING
+%token <sym>    ID
+%token <sval>   STRING
 %token          COMMA COLON SEMICOLON LP RP LK RK LC RC
                 DOT PLUS MINUS TIMES DIVIDE EQ NEQ LT LE GT GE AND OR ASSIGN
                 ARRAY IF THEN ELSE WHILE FOR TO DO LET IN END OF BREAK NIL
@@ -90,7 +104,7 @@ int parse(const char *filename)
 
 %%
 
-program: exp { AST_root = $1; }
+program: exp { *root = $1; }
 
 /****************************************************************************
  * declares
@@ -98,34 +112,36 @@ program: exp { AST_root = $1; }
 
 decs
 : /* epsilon */  { $$ = NULL; }
-| dec decs       { $$ = AST_mk_dec_list($1, $2); }
+| decs dec       { $$ = $2 ? AST_push_dec($1, $2) : $1; }
 
+/* a bad declaration is skipped up to the next one or 'in', and left out. */
 dec
 : dec_var  { $$ = $1; }
 | dec_type { $$ = $1; }
 | dec_func { $$ = $1; }
+| error    { $$ = NULL; }
 
 dec_var
 : VAR ID ASSIGN exp {
-    $$ = AST_mk_dec_var(0, SYM_declare($2), NULL, $4);
+    $$ = AST_mk_dec_var(@$, $2, NULL, $4);
 }
 | VAR ID COLON ID ASSIGN exp {
-    $$ = AST_mk_dec_var(0, SYM_declare($2), SYM_declare($4), $6);
+    $$ = AST_mk_dec_var(@$, $2, $4, $6);
 }
 
 dec_type
-: TYPE ID EQ type { $$ = AST_mk_dec_type(SYM_declare($2), $4); }
+: TYPE ID EQ type { $$ = AST_mk_dec_type(@$, $2, $4); }
 
 dec_func
 : FUNCTION ID LP RP EQ exp {
-    $$ = AST_mk_dec_func(0, SYM_declare($2), NULL, NULL, $6); }
+    $$ = AST_mk_dec_func(@$, $2, NULL, NULL, $6); }
 | FUNCTION ID LP RP COLON ID EQ exp {
-    $$ = AST_mk_dec_func(0, SYM_declare($2), NULL, SYM_declare($6), $8);
+    $$ = AST_mk_dec_func(@$, $2, NULL, $6, $8);
 }
 | FUNCTION ID LP paras RP EQ exp {
-    $$ = AST_mk_dec_func(0,  SYM_declare($2), $4, NULL, $7); }
+    $$ = AST_mk_dec_func(@$, $2, $4, NULL, $7); }
 | FUNCTION ID LP paras RP COLON ID EQ exp {
-    $$ = AST_mk_dec_func(0, SYM_declare($2), $4, SYM_declare($7), $9);
+    $$ = AST_mk_dec_func(@$, $2, $4, $7, $9);
 }
 
 /****************************************************************************
@@ -144,112 +160,117 @@ exp
 | exp_while  { $$ = $1; }
 | exp_break  { $$ = $1; }
 | exp_let    { $$ = $1; }
-| error      { ; }
+| error      { $$ = NULL; }
 
 exp_value
-: NIL       { $$ = AST_mk_exp_nil(0); }
-| INT       { $$ = AST_mk_exp_int(0, $1); }
-| STRING    { $$ = AST_mk_exp_str(0, $1); }
-| lvalue    { $$ = AST_mk_exp_var(0, $1); }
+: NIL       { $$ = AST_mk_exp_nil(@$); }
+| INT       { $$ = AST_mk_exp_int(@$, $1); }
+| STRING    { $$ = AST_mk_exp_str(@$, $1); }
+| lvalue    { $$ = AST_mk_exp_var(@$, $1); }
 
 exp_seq
-: LP RP          { $$ = AST_mk_exp_seq(0, NULL); }
-| LP sequence RP { $$ = AST_mk_exp_seq(0, $2); }
+: LP RP          { $$ = AST_mk_exp_seq(@$, NULL); }
+| LP sequence RP { $$ = AST_mk_exp_seq(@$, $2); }
 
 exp_op
-: exp PLUS exp   { $$ = AST_mk_exp_op(0, AST_kind_op_plus,   $1, $3); }
-| exp MINUS exp  { $$ = AST_mk_exp_op(0, AST_kind_op_minus,  $1, $3); }
-| exp TIMES exp  { $$ = AST_mk_exp_op(0, AST_kind_op_times,  $1, $3); }
-| exp DIVIDE exp { $$ = AST_mk_exp_op(0, AST_kind_op_divide, $1, $3); }
-| exp EQ exp     { $$ = AST_mk_exp_op(0, AST_kind_op_eq,     $1, $3); }
-| exp NEQ exp    { $$ = AST_mk_exp_op(0, AST_kind_op_neq,    $1, $3); }
-| exp LT exp     { $$ = AST_mk_exp_op(0, AST_kind_op_lt,     $1, $3); }
-| exp LE exp     { $$ = AST_mk_exp_op(0, AST_kind_op_le,     $1, $3); }
-| exp GT exp     { $$ = AST_mk_exp_op(0, AST_kind_op_gt,     $1, $3); }
-| exp GE exp     { $$ = AST_mk_exp_op(0, AST_kind_op_ge,     $1, $3); }
+: exp PLUS exp   { $$ = AST_mk_exp_op(@2, AST_kind_op_plus,   $1, $3); }
+| exp MINUS exp  { $$ = AST_mk_exp_op(@2, AST_kind_op_minus,  $1, $3); }
+| exp TIMES exp  { $$ = AST_mk_exp_op(@2, AST_kind_op_times,  $1, $3); }
+| exp DIVIDE exp { $$ = AST_mk_exp_op(@2, AST_kind_op_divide, $1, $3); }
+| exp EQ exp     { $$ = AST_mk_exp_op(@2, AST_kind_op_eq,     $1, $3); }
+| exp NEQ exp    { $$ = AST_mk_exp_op(@2, AST_kind_op_neq,    $1, $3); }
+| exp LT exp     { $$ = AST_mk_exp_op(@2, AST_kind_op_lt,     $1, $3); }
+| exp LE exp     { $$ = AST_mk_exp_op(@2, AST_kind_op_le,     $1, $3); }
+| exp GT exp     { $$ = AST_mk_exp_op(@2, AST_kind_op_gt,     $1, $3); }
+| exp GE exp     { $$ = AST_mk_exp_op(@2, AST_kind_op_ge,     $1, $3); }
 | MINUS exp %prec UMINUS {
-    $$ = AST_mk_exp_op(0, AST_kind_op_minus, AST_mk_exp_int(0, 0), $2);
+    $$ = AST_mk_exp_op(@$, AST_kind_op_minus, AST_mk_exp_int(@$, 0), $2);
 }
 
 exp_call
-: ID LP RP           { $$ = AST_mk_exp_call(0, SYM_declare($1), NULL); }
-| ID LP arguments RP { $$ = AST_mk_exp_call(0, SYM_declare($1), $3); }
+: ID LP RP           { $$ = AST_mk_exp_call(@$, $1, NULL); }
+| ID LP arguments RP { $$ = AST_mk_exp_call(@$, $1, $3); }
 
 exp_create
-: ID LC RC      { $$ = AST_mk_exp_record(0, SYM_declare($1), NULL); }
-| ID LC args RC { $$ = AST_mk_exp_record(0, SYM_declare($1), $3); }
-| ID LK exp RK OF exp { $$ = AST_mk_exp_array(0, SYM_declare($1), $3, $6); }
+: ID LC RC      { $$ = AST_mk_exp_record(@$, $1, NULL); }
+| ID LC args RC { $$ = AST_mk_exp_record(@$, $1, $3); }
+| ID LK exp RK OF exp { $$ = AST_mk_exp_array(@$, $1, $3, $6); }
 
 exp_assign
-: lvalue ASSIGN exp { $$ = AST_mk_exp_assign(0, $1, $3); }
+: lvalue ASSIGN exp { $$ = AST_mk_exp_assign(@2, $1, $3); }
 
 exp_if
-: IF exp THEN exp ELSE exp { $$ = AST_mk_exp_if(0, $2, $4, $6); }
-| IF exp THEN exp { $$ = AST_mk_exp_if(0, $2, $4, NULL); }
-| exp AND exp     { $$ = AST_mk_exp_if(0, $1, $3, AST_mk_exp_int(0, 0)); }
-| exp OR exp      { $$ = AST_mk_exp_if(0, $1, AST_mk_exp_int(0, 1), $3); }
+: IF exp THEN exp ELSE exp { $$ = AST_mk_exp_if(@$, $2, $4, $6); }
+| IF exp THEN exp { $$ = AST_mk_exp_if(@$, $2, $4, NULL); }
+| exp AND exp     { $$ = AST_mk_exp_if(@2, $1, $3, AST_mk_exp_int(@2, 0)); }
+| exp OR exp      { $$ = AST_mk_exp_if(@2, $1, AST_mk_exp_int(@2, 1), $3); }
 
 exp_for
 : FOR ID ASSIGN exp TO exp DO exp {
-    $$ = AST_mk_exp_for(0, SYM_declare($2), $4, $6, $8);
+    $$ = AST_mk_exp_for(@$, $2, $4, $6, $8);
 }
 
 exp_while
-: WHILE exp DO exp { $$ = AST_mk_exp_while(0, $2, $4); }
+: WHILE exp DO exp { $$ = AST_mk_exp_while(@$, $2, $4); }
 
 exp_break
-: BREAK { $$ = AST_mk_exp_break(0); }
+: BREAK { $$ = AST_mk_exp_break(@$); }
 
 exp_let
-: LET decs IN END          { $$ = AST_mk_exp_let(0, $2, NULL); }
-| LET decs IN sequence END { $$ = AST_mk_exp_let(0, $2, $4); }
+: LET decs IN END          { $$ = AST_mk_exp_let(@$, $2, NULL); }
+| LET decs IN sequence END { $$ = AST_mk_exp_let(@$, $2, $4); }
 
 /****************************************************************************
  * variables
  ****************************************************************************/
 
+/* a bare ID is a base with an empty suffix, a rule of its own for it
+ * would make every token after an ID a reduce/reduce conflict. */
 lvalue
-: ID         { $$ = AST_mk_var_base(0, SYM_declare($1), NULL); }
-| ID suffix  { $$ = AST_mk_var_base(0, SYM_declare($1), $2); }
+: ID suffix  { $$ = AST_mk_var_base(@$, $1, $2); }
 
 suffix
 : /* spsilon */    { $$ = NULL; }
-| LK exp RK suffix { $$ = AST_mk_var_index(0, $2, $4); }
-| DOT ID suffix    { $$ = AST_mk_var_field(0, SYM_declare($2), $3); }
+| LK exp RK suffix { $$ = AST_mk_var_index(@$, $2, $4); }
+| DOT ID suffix    { $$ = AST_mk_var_field(@$, $2, $3); }
 
 /****************************************************************************
  * types
  ****************************************************************************/
 
 type
-: ID          { $$ = AST_mk_type_name(0, SYM_declare($1)); }
-| ARRAY OF ID { $$ = AST_mk_type_array(0, SYM_declare($3)); }
-| LC paras RC { $$ = AST_mk_type_record(0, $2); }
-| LC RC       { $$ = AST_mk_type_record(0, NULL); }
+: ID          { $$ = AST_mk_type_name(@$, $1); }
+| ARRAY OF ID { $$ = AST_mk_type_array(@$, $3); }
+| LC paras RC { $$ = AST_mk_type_record(@$, $2); }
+| LC RC       { $$ = AST_mk_type_record(@$, NULL); }
 
 /****************************************************************************
- * link list
+ * list
  ****************************************************************************/
 
+/* Lists are left recursive so the parser stack stays flat however long
+ * they are, each element is pushed to the back of its list.
+ */
+
 paras
-: para             { $$ = AST_mk_para_list($1, NULL); }
-| para COMMA paras { $$ = AST_mk_para_list($1, $3); }
+: para             { $$ = AST_push_para(NULL, $1); }
+| paras COMMA para { $$ = AST_push_para($1, $3); }
 
 para
-: ID COLON ID { $$ = AST_mk_para(0, SYM_declare($1), SYM_declare($3)); }
+: ID COLON ID { $$ = AST_mk_para(@$, $1, $3); }
 
 args
-: arg            { $$ = AST_mk_arg_list($1, NULL); }
-| arg COMMA args { $$ = AST_mk_arg_list($1, $3); }
+: arg            { $$ = AST_push_arg(NULL, $1); }
+| args COMMA arg { $$ = AST_push_arg($1, $3); }
 
 arg
-: ID EQ exp { $$ = AST_mk_arg(SYM_declare($1), $3); }
+: ID EQ exp { $$ = AST_mk_arg($1, $3); }
 
 sequence
-: exp                    { $$ = AST_mk_exp_list($1, NULL); }
-| exp SEMICOLON sequence { $$ = AST_mk_exp_list($1, $3); }
+: exp                    { $$ = AST_push_exp(NULL, $1); }
+| sequence SEMICOLON exp { $$ = AST_push_exp($1, $3); }
 
 arguments
-: exp                 { $$ = AST_mk_exp_list($1, NULL); }
-| exp COMMA arguments { $$ = AST_mk_exp_list($1, $3); }
+: exp                 { $$ = AST_push_exp(NULL, $1); }
+| arguments COMMA exp { $$ = AST_push_exp($1, $3); }
 
@@ -0,0 +1,297 @@
+/****************************************************************************
+ * Includes
+ ****************************************************************************/
+
+#include <pthread.h>
+#include <sched.h>
+#include <setjmp.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "context.h"
+#include "lexer.h"
+#include "token.h"
+#include "util.h"
+#include "y.tab.h"
+
+/****************************************************************************
+ * Definitions
+ ****************************************************************************/
+
+#define TOK_MIN_SIZE    64  /*< first array size */
+#define TOK_DENSITY     4   /*< guessed bytes of source per token */
+#define TOK_RING_SIZE   4096    /*< tokens in flight, power of 2 */
+#define TOK_RING_BATCH  64      /*< tokens published at once, divides size */
+#define TOK_CACHE_LINE  64
+
+struct TOK_array_
+{
+    TOK_token * tokens;
+    int         n;      /*< tokens, without the ending one */
+    int         cap;
+    int         next;   /*< next token for TOK_next() */
+};
+
+/* Single producer, single consumer. Indices run freely and are masked on
+ * access, each side publishes its index every TOK_RING_BATCH tokens so the
+ * shared cache lines move rarely.
+ */
+struct TOK_pipe_
+{
+    TOK_token   ring[TOK_RING_SIZE];
+
+    _Alignas(TOK_CACHE_LINE)
+    atomic_uint head;   /*< tokens pushed, by lexer thread */
+    _Alignas(TOK_CACHE_LINE)
+    atomic_uint tail;   /*< tokens pulled, by parser thread */
+    atomic_bool stop;   /*< parser is done, by parser thread */
+
+    _Alignas(TOK_CACHE_LINE)
+    unsigned    next;   /*< parser private, next token to pull */
+    unsigned    ready;  /*< parser private, head last seen */
+
+    _Alignas(TOK_CACHE_LINE)
+    unsigned    pushed; /*< lexer private, tokens pushed */
+    unsigned    seen;   /*< lexer private, tail last seen */
+    bool        failed; /*< lexer bailed, set before its end is published */
+
+    TIGER_ctx   ctx;
+    pthread_t   thread;
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/**
+ * @brief Wait for a free slot, false if parser stopped meanwhile.
+ */
+static bool TOK_room(TOK_pipe p)
+{
+    while (p->pushed - p->seen == TOK_RING_SIZE) {
+        p->seen = atomic_load_explicit(&p->tail, memory_order_acquire);
+        if (p->pushed - p->seen < TOK_RING_SIZE)
+            break;
+        if (atomic_load_explicit(&p->stop, memory_order_relaxed))
+            return false;
+        sched_yield();
+    }
+
+    return true;
+}
+
+/**
+ * @brief Lexer thread, fill ring until end of source or stopped.
+ */
+static void *TOK_produce(void *arg)
+{
+    TOK_pipe p = arg;
+    jmp_buf bail;
+    TOK_token *t;
+    YYSTYPE lval;
+    YYLTYPE lloc;
+    int kind;
+
+    TIGER_use(p->ctx);
+    TIGER_bail_thread(&bail);
+
+    // error is reported, end source here, parser bails once it gets there.
+    if (setjmp(bail)) {
+        p->failed = true;
+        if (TOK_room(p)) {
+            t = &p->ring[p->pushed & (TOK_RING_SIZE - 1)];
+            t->kind = 0;
+            t->pos  = 0;
+            t->len  = 0;
+            atomic_store_explicit(&p->head, ++p->pushed, memory_order_release);
+        }
+        return NULL;
+    }
+
+    do {
+        if (!TOK_room(p))
+            return NULL;
+
+        kind = LEX_scan(&lval, &lloc);
+
+        t = &p->ring[p->pushed & (TOK_RING_SIZE - 1)];
+        t->kind = kind;
+        t->pos  = lloc;
+        t->len  = LEX_length();
+
+        switch (kind) {
+            case INT:
+            case LEX_BAD: t->u.ival = lval.ival; break;
+            case STRING:  t->u.sval = lval.sval; break;
+            case ID:      t->u.sym  = lval.sym;  break;
+            default:      t->u.sval = NULL;      break;
+        }
+
+        if (++p->pushed % TOK_RING_BATCH == 0 || !kind)
+            atomic_store_explicit(&p->head, p->pushed, memory_order_release);
+    } while (kind);
+
+    return NULL;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+TOK_array TOK_lex(SRC_source src)
+{
+    TOK_array a = UTL_alloc_as(UTL_tag_other, sizeof(*a));
+    TOK_token *t;
+    YYSTYPE lval;
+    YYLTYPE lloc;
+    int kind;
+
+    a->n    = 0;
+    a->next = 0;
+    a->cap  = SRC_size(src) / TOK_DENSITY + TOK_MIN_SIZE;
+    a->tokens = malloc(a->cap * sizeof(a->tokens[0]));
+
+    LEX_source(src);
+
+    do {
+        if (!a->tokens)
+            UTL_error(UTL_NOPOS, "run out of memory");
+
+        kind = LEX_scan(&lval, &lloc);
+
+        t = &a->tokens[a->n];
+        t->kind = kind;
+        t->pos  = lloc;
+        t->len  = LEX_length();
+
+        switch (kind) {
+            case INT:
+            case LEX_BAD: t->u.ival = lval.ival; break;
+            case STRING:  t->u.sval = lval.sval; break;
+            case ID:      t->u.sym  = lval.sym;  break;
+            default:      t->u.sval = NULL;      break;
+        }
+
+        if (kind && ++a->n == a->cap)
+            a->tokens = realloc(a->tokens,
+                                (a->cap *= 2) * sizeof(a->tokens[0]));
+    } while (kind);
+
+    LEX_source(NULL);
+    return a;
+}
+
+void TOK_free(TOK_array tokens)
+{
+    free(tokens->tokens);
+    tokens->tokens = NULL;
+    tokens->n      = 0;
+}
+
+int TOK_size(TOK_array tokens)
+{
+    return tokens->n;
+}
+
+int TOK_next(TOK_array tokens, YYSTYPE *lval, YYLTYPE *lloc)
+{
+    TOK_token *t = &tokens->tokens[tokens->next];
+
+    if (t->kind)
+        tokens->next++;
+
+    *lloc = t->pos;
+    switch (t->kind) {
+        case INT:
+        case LEX_BAD: lval->ival = t->u.ival; break;
+        case STRING:  lval->sval = t->u.sval; break;
+        case ID:      lval->sym  = t->u.sym;  break;
+    }
+
+    return t->kind;
+}
+
+void TOK_rewind(TOK_array tokens)
+{
+    tokens->next = 0;
+}
+
+TOK_pipe TOK_start(SRC_source src)
+{
+    TOK_pipe p = aligned_alloc(TOK_CACHE_LINE, sizeof(*p));
+
+    if (!p)
+        UTL_error(UTL_NOPOS, "run out of memory");
+
+    atomic_init(&p->head, 0);
+    atomic_init(&p->tail, 0);
+    atomic_init(&p->stop, false);
+    p->next   = 0;
+    p->ready  = 0;
+    p->pushed = 0;
+    p->seen   = 0;
+    p->failed = false;
+    p->ctx    = TIGER_cur();
+
+    // scanner is set up here, lexer thread only scans.
+    LEX_source(src);
+
+    if (pthread_create(&p->thread, NULL, TOK_produce, p)) {
+        LEX_source(NULL);
+        free(p);
+        UTL_error(UTL_NOPOS, "cannot create lexer thread");
+    }
+
+    return p;
+}
+
+int TOK_pull(TOK_pipe p, YYSTYPE *lval, YYLTYPE *lloc)
+{
+    TOK_token *t;
+    int kind;
+
+    while (p->next == p->ready) {
+        p->ready = atomic_load_explicit(&p->head, memory_order_acquire);
+        if (p->next == p->ready)
+            sched_yield();
+    }
+
+    t = &p->ring[p->next & (TOK_RING_SIZE - 1)];
+
+    // its end is published after failed is set, seen by the acquire.
+    if (!t->kind && p->failed)
+        UTL_error(UTL_NOPOS, "lexer thread failed");
+
+    kind  = t->kind;
+    *lloc = t->pos;
+    switch (kind) {
+        case INT:
+        case LEX_BAD: lval->ival = t->u.ival; break;
+        case STRING:  lval->sval = t->u.sval; break;
+        case ID:      lval->sym  = t->u.sym;  break;
+    }
+
+    // slot is copied out, it may be handed back.
+    if (kind && ++p->next % TOK_RING_BATCH == 0)
+        atomic_store_explicit(&p->tail, p->next, memory_order_release);
+
+    return kind;
+}
+
+void TOK_stop(TOK_pipe p)
+{
+    atomic_store_explicit(&p->stop, true, memory_order_relaxed);
+    pthread_join(p->thread, NULL);
+
+    LEX_source(NULL);
+    free(p);
+}
+
+void TOK_dump(FILE *out, SRC_source src, TOK_array tokens)
+{
+    const char *text = SRC_text(src);
+    TOK_token *t;
+
+    for (t = tokens->tokens; t->kind; t++)
+        fprintf(out, "%10.*s\n", t->len, text + t->pos);
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+/****************************************************************************
+ * Includes
+ ****************************************************************************/
+
+#include <stdio.h>
+#include "ast.h"
+#include "source.h"
+#include "symbol.h"
+
+/****************************************************************************
+ * Definitions
+ ****************************************************************************/
+
+union YYSTYPE;   /*< semantic value, see y.tab.h */
+
+/**
+ * @brief Pre-lexed token.
+ */
+typedef struct TOK_token_
+{
+    int     kind;   /*< token of y.tab.h or LEX_BAD, 0 is end of source */
+    Apos    pos;
+    int     len;
+    union {
+        int             ival;
+        const char *    sval;
+        SYM_symbol      sym;
+    } u;
+} TOK_token;
+
+/**
+ * @brief Whole source lexed into one array, ended by a token of kind 0.
+ */
+typedef struct TOK_array_ *TOK_array;
+
+/**
+ * @brief Tokens passed from a lexer thread to the parser, bounded ring.
+ */
+typedef struct TOK_pipe_ *TOK_pipe;
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/**
+ * @brief Lex whole source with selected lexer, see LEX_use().
+ *
+ * @param[in] src
+ * @return TOK_array
+ */
+TOK_array TOK_lex(SRC_source src);
+
+/**
+ * @brief Free token array.
+ *
+ * @param[in] tokens
+ */
+void TOK_free(TOK_array tokens);
+
+/**
+ * @brief Number of tokens, without the ending one.
+ *
+ * @param[in] tokens
+ * @return int
+ */
+int TOK_size(TOK_array tokens);
+
+/**
+ * @brief Next token for the parser, same contract as LEX_next().
+ *
+ * Stays at the ending token once it is reached.
+ *
+ * @param[in] tokens
+ * @param[out] lval
+ * @param[out] lloc
+ * @return int  Token.
+ */
+int TOK_next(TOK_array tokens, union YYSTYPE *lval, Apos *lloc);
+
+/**
+ * @brief Serve tokens from the first again, to parse a second time.
+ *
+ * @param[in] tokens
+ */
+void TOK_rewind(TOK_array tokens);
+
+/**
+ * @brief Print text of every token, one per line.
+ *
+ * @param[in] out
+ * @param[in] src       Source lexed into tokens.
+ * @param[in] tokens
+ */
+void TOK_dump(FILE *out, SRC_source src, TOK_array tokens);
+
+/**
+ * @brief Start lexing source with selected lexer on a thread of its own.
+ *
+ * The lexer thread shares current context. Until TOK_stop() it owns the
+ * lexer, symbol table, string pool and global region, the calling thread
+ * may only allocate in other regions. Tag tracking must be off. An error
+ * on the lexer thread ends its tokens there, see TOK_pull().
+ *
+ * @param[in] src
+ * @return TOK_pipe
+ */
+TOK_pipe TOK_start(SRC_source src);
+
+/**
+ * @brief Next token from lexer thread, same contract as LEX_next().
+ *
+ * Waits while the ring is empty, stays at the ending token. Ending token
+ * of a failed lexer thread fails with UTL_error() on the calling thread.
+ *
+ * @param[in] pipe
+ * @param[out] lval
+ * @param[out] lloc
+ * @return int  Token.
+ */
+int TOK_pull(TOK_pipe pipe, union YYSTYPE *lval, Apos *lloc);
+
+/**
+ * @brief Stop lexer thread, whether it reached the end or not, and free pipe.
+ *
+ * @param[in] pipe
+ */
+void TOK_stop(TOK_pipe pipe);
@@ -2,6 +2,7 @@
  * Includes
  ****************************************************************************/
 
+#include "context.h"
 #include "frame.h"
 #include "translate.h"
 
@@ -13,19 +14,34 @@ struct TR_level_ { TR_level parent;  FRM_frame frame; TR_access_list paras; };
 struct TR_access_ { TR_level level; FRM_access access; };
 struct TR_access_list_ { TR_access head; TR_access_list tail; };
 
-/****************************************************************************
- * Private Variables
- ****************************************************************************/
-
-static TR_level root_level;
+/**
+ * @brief Translate state of a context.
+ */
+typedef struct TR_state_
+{
+    TR_level root_level;
+} TR_state;
 
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
 
+/**
+ * @brief State of current context.
+ */
+static inline TR_state *TR_cur(void)
+{
+    TIGER_ctx ctx = TIGER_cur();
+
+    if (__builtin_expect(!ctx->tr, 0))
+        ctx->tr = TIGER_mk_state(sizeof(*ctx->tr));
+
+    return ctx->tr;
+}
+
 static TR_access_list TR_mk_access_list(TR_access head, TR_access_list tail)
 {
-    TR_access_list p = UTL_alloc(sizeof(*p));
+    TR_access_list p = UTL_alloc_as(UTL_tag_frame, sizeof(*p));
 
     p->head = head;
     p->tail = tail;
@@ -35,7 +51,7 @@ static TR_access_list TR_mk_access_list(TR_access head, TR_access_list tail)
 
 static TR_access TR_mk_access(TR_level level, FRM_access access)
 {
-    TR_access p = UTL_alloc(sizeof(*p));
+    TR_access p = UTL_alloc_as(UTL_tag_frame, sizeof(*p));
 
     p->level  = level;
     p->access = access;
@@ -46,7 +62,7 @@ static TR_access TR_mk_access(TR_level level, FRM_access access)
 static TR_level TR_mk_level_(TR_level parent, TMP_label name,
                              UTL_bool_list escapes)
 {
-    TR_level p = UTL_alloc(sizeof(*p));
+    TR_level p = UTL_alloc_as(UTL_tag_frame, sizeof(*p));
 
     p->parent = parent;
     p->frame  = FRM_mk_frame(name, escapes);
@@ -92,10 +108,13 @@ TR_level TR_mk_level(TR_level parent, TMP_label name, UTL_bool_list escapes)
 
 TR_level TR_root_level(void)
 {
-    if (!root_level)
-        root = TR_mk_level(NULL, TMP_mk_label_named("__root__"), NULL);
+    TR_state *st = TR_cur();
+
+    if (!st->root_level)
+        st->root_level = TR_mk_level(NULL, TMP_mk_label_named("__root__"),
+                                     NULL);
 
-    return root;
+    return st->root_level;
 }
 
 TR_access_list TR_get_paras(TR_level level)
@@ -55,6 +55,13 @@ TY_type TY_void(void)
     return &type_void;
 }
 
+TY_type TY_poison(void)
+{
+    static struct TY_type_ type_poison = { TY_kind_poison };
+
+    return &type_poison;
+}
+
 
 /****************************************************************************
  * Public: type constructor
@@ -62,7 +69,7 @@ TY_type TY_void(void)
 
 TY_type TY_mk_name(SYM_symbol symbol, TY_type type)
 {
-    TY_type t = UTL_alloc(sizeof(*t));
+    TY_type t = UTL_alloc_as(UTL_tag_type, sizeof(*t));
 
     t->kind          = TY_kind_name;
     t->u.name.symbol = symbol;
@@ -73,7 +80,7 @@ TY_type TY_mk_name(SYM_symbol symbol, TY_type type)
 
 TY_type TY_mk_func(TY_type ret, TY_type_list paras)
 {
-    TY_type t = UTL_alloc(sizeof(*t));
+    TY_type t = UTL_alloc_as(UTL_tag_type, sizeof(*t));
 
     t->kind         = TY_kind_func;
     t->u.func.ret   = ret;
@@ -84,7 +91,7 @@ TY_type TY_mk_func(TY_type ret, TY_type_list paras)
 
 TY_type TY_mk_array(TY_type type)
 {
-    TY_type t = UTL_alloc(sizeof(*t));
+    TY_type t = UTL_alloc_as(UTL_tag_type, sizeof(*t));
 
     t->kind    = TY_kind_array;
     t->u.array = type;
@@ -94,7 +101,7 @@ TY_type TY_mk_array(TY_type type)
 
 TY_type TY_mk_record(TY_field_list fields)
 {
-    TY_type t = UTL_alloc(sizeof(*t));
+    TY_type t = UTL_alloc_as(UTL_tag_type, sizeof(*t));
 
     t->kind     = TY_kind_record;
     t->u.record = fields;
@@ -108,7 +115,7 @@ TY_type TY_mk_record(TY_field_list fields)
 
 TY_field TY_mk_field(SYM_symbol name, TY_type type)
 {
-    TY_field t = UTL_alloc(sizeof(*t));
+    TY_field t = UTL_alloc_as(UTL_tag_type, sizeof(*t));
 
     t->name = name;
     t->type = type;
@@ -118,7 +125,7 @@ TY_field TY_mk_field(SYM_symbol name, TY_type type)
 
 TY_type_list TY_mk_type_list(TY_type head, TY_type_list tail)
 {
-    TY_type_list t = UTL_alloc(sizeof(*t));
+    TY_type_list t = UTL_pool_alloc(UTL_tag_type, sizeof(*t));
 
     t->head = head;
     t->tail = tail;
@@ -126,9 +133,19 @@ TY_type_list TY_mk_type_list(TY_type head, TY_type_list tail)
     return t;
 }
 
+void TY_free_type_list(TY_type_list list)
+{
+    TY_type_list tail;
+
+    for (; list; list = tail) {
+        tail = list->tail;
+        UTL_pool_free(UTL_tag_type, list, sizeof(*list));
+    }
+}
+
 TY_field_list TY_mk_field_list(TY_field head, TY_field_list tail)
 {
-    TY_field_list t = UTL_alloc(sizeof(*t));
+    TY_field_list t = UTL_pool_alloc(UTL_tag_type, sizeof(*t));
 
     t->head = head;
     t->tail = tail;
@@ -156,6 +173,10 @@ inline bool TY_match(TY_type left, TY_type right)
     if (left == right)
         return true;
 
+    if (TY_get_kind(left) == TY_kind_poison ||
+        TY_get_kind(right) == TY_kind_poison)
+        return true;
+
     if (TY_get_kind(left) == TY_kind_record && TY_get_kind(right) == TY_kind_nil)
         return true;
 
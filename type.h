@@ -28,6 +28,7 @@ struct TY_type_
         TY_kind_func,
         TY_kind_array,
         TY_kind_record,
+        TY_kind_poison,     /*< of erroneous code, matches anything */
     } kind;
 
     union {
@@ -66,6 +67,11 @@ TY_type TY_str(void);
  * @return pre-defined type.
  */
 TY_type TY_void(void);
+/**
+ * poison type, given to what failed checking so errors do not cascade.
+ * @return pre-defined type.
+ */
+TY_type TY_poison(void);
 
 /****************************************************************************
  * Public: type constructor
@@ -116,6 +122,11 @@ TY_field TY_mk_field(SYM_symbol name, TY_type type);
  * @return new field
  */
 TY_type_list TY_mk_type_list(TY_type head, TY_type_list tail);
+/**
+ * give type list nodes back to pool, heads are kept.
+ * @param[in] list
+ */
+void TY_free_type_list(TY_type_list list);
 /**
  * make record field list node.
  * @param[in] head
@@ -2,39 +2,271 @@
  * Include Files
  ****************************************************************************/
 
+#include <setjmp.h>
 #include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "context.h"
 #include "util.h"
 
 /****************************************************************************
  * Definitions
  ****************************************************************************/
 
-typedef struct UTL_slice_ * UTL_slice;
+#define UTL_ALIGN       16              /*< alignment of every allocation */
+#define UTL_CHUNK_MIN   (64 * 1024)     /*< size of the first chunk */
+#define UTL_CHUNK_MAX   (16 * 1024 * 1024) /*< chunk size stops growing */
 
-struct UTL_slice_
+#define UTL_REGION_DEPTH 16             /*< max nesting of entered regions */
+
+#define UTL_POOL_GRAIN   16             /*< size class step */
+#define UTL_POOL_CLASSES 4              /*< 16, 32, 48 and 64 bytes */
+
+#define UTL_DIAG_MAX    100             /*< errors before giving up */
+
+typedef struct UTL_chunk_ * UTL_chunk;
+typedef struct UTL_arena_   UTL_arena;
+typedef struct UTL_block_ * UTL_block;
+typedef struct UTL_pool_    UTL_pool;
+typedef struct UTL_stat_    UTL_stat;
+typedef struct UTL_state_   UTL_state;
+
+/**
+ * @brief Arena chunk.
+ *
+ * Objects are bumped from [base, limit), chunks are never reused until
+ * UTL_free().
+ */
+struct UTL_chunk_
+{
+    UTL_chunk   next;
+    size_t      size;   /*< bytes malloced for this chunk (with header) */
+    char *      base;   /*< next free byte */
+    char *      limit;  /*< end of chunk */
+};
+
+/**
+ * @brief Recycled object, linked in its size class free list.
+ */
+struct UTL_block_ { UTL_block next; };
+
+/**
+ * @brief Size class counters.
+ */
+struct UTL_pool_
+{
+    size_t hits;    /*< served from free list */
+    size_t misses;  /*< served from arena */
+    size_t frees;   /*< returned to free list */
+};
+
+/**
+ * @brief Allocation counters of a tag.
+ */
+struct UTL_stat_
 {
-    void *  ptr;
-    UTL_slice next;
+    size_t count;   /*< allocations */
+    size_t bytes;   /*< bytes held now */
+    size_t peak;    /*< high-water mark of bytes */
+};
+
+/**
+ * @brief Bump-pointer arena, one for each region.
+ */
+struct UTL_arena_
+{
+    UTL_block   blocks[UTL_POOL_CLASSES];   /*< free lists of size classes */
+    UTL_chunk   chunks;     /*< newest chunk first */
+    size_t      chunk_next; /*< size of next regular chunk */
+    size_t      size;       /*< bytes malloced for chunks */
+    size_t      used;       /*< bytes handed out */
+    size_t      peak;       /*< high-water mark of size */
+    size_t      tags[UTL_tag_max]; /*< bytes held by each tag, if tracking */
+};
+
+/**
+ * @brief Memory and diagnostics state of a context.
+ */
+struct UTL_state_
+{
+    UTL_arena   arenas[UTL_region_max];
+    UTL_arena   strings;                    /*< string pool, not aligned */
+    UTL_region  stack[UTL_REGION_DEPTH];    /*< entered regions */
+    int         depth;                      /*< stack[depth] is current */
+    UTL_pool    pools[UTL_POOL_CLASSES];
+    bool        tracking;                   /*< count allocations by tag */
+    UTL_stat    stats[UTL_tag_max];
+    UTL_locator locator;                    /*< positions for UTL_error */
+    void *      locator_ctx;
+    int         errors;                     /*< reported by UTL_diag */
+    bool        quiet;                      /*< UTL_diag only counts */
+    int         quiet_errors;               /*< counted while quiet */
 };
 
 /****************************************************************************
  * Privates
  ****************************************************************************/
 
-static UTL_slice slices;
+static const char *region_name[UTL_region_max] =
+{
+    "global",
+    "parse",
+    "semant",
+};
 
-static void UTL_add(void* p)
+static const char *tag_name[UTL_tag_max] =
 {
-    UTL_slice s = malloc(sizeof(*s));
-    if (!s)
-        UTL_error(0, "run out of memory");
+    "other",
+    "ast",
+    "symbol",
+    "bind",
+    "type",
+    "frame",
+    "temp",
+};
 
-    s->ptr  = p;
-    s->next = slices;
-    slices  = s;
+/**
+ * @brief State of current context.
+ */
+static inline UTL_state *UTL_cur(void)
+{
+    TIGER_ctx ctx = TIGER_cur();
+
+    if (__builtin_expect(!ctx->utl, 0))
+        ctx->utl = TIGER_mk_state(sizeof(*ctx->utl));
+
+    return ctx->utl;
+}
+
+static inline char *UTL_align(char *p)
+{
+    return (char *)(((uintptr_t)p + UTL_ALIGN - 1) & ~(uintptr_t)(UTL_ALIGN - 1));
+}
+
+/**
+ * @brief Get a new chunk which can hold at least size bytes.
+ *
+ * Regular chunks grow geometrically, oversized requests get a chunk of
+ * their own which is linked behind the current one, so the bump pointer
+ * of the current chunk is not wasted.
+ *
+ * @param[in] a     Arena.
+ * @param[in] size  Requested bytes.
+ * @return UTL_chunk
+ */
+static UTL_chunk UTL_mk_chunk(UTL_arena *a, size_t size)
+{
+    size_t need = sizeof(struct UTL_chunk_) + UTL_ALIGN + size;
+    size_t want;
+    UTL_chunk c;
+
+    if (!a->chunk_next)
+        a->chunk_next = UTL_CHUNK_MIN;
+
+    if (need > a->chunk_next / 2) {
+        want = need;
+    } else {
+        want = a->chunk_next;
+        if (a->chunk_next < UTL_CHUNK_MAX)
+            a->chunk_next *= 2;
+    }
+
+    c = malloc(want);
+    if (!c)
+        UTL_error(UTL_NOPOS, "run out of memory");
+
+    c->size  = want;
+    c->base  = (char *)(c + 1);
+    c->limit = (char *)c + want;
+
+    if (want == need && a->chunks) {
+        c->next          = a->chunks->next;
+        a->chunks->next  = c;
+    } else {
+        c->next   = a->chunks;
+        a->chunks = c;
+    }
+
+    a->size += want;
+    if (a->size > a->peak)
+        a->peak = a->size;
+
+    return c;
+}
+
+static void *UTL_arena_alloc(UTL_arena *a, int size)
+{
+    UTL_chunk c = a->chunks;
+    char *p;
+
+    if (size < 0)
+        UTL_error(UTL_NOPOS, "alloc negative size");
+
+    p = c ? UTL_align(c->base) : NULL;
+    if (!p || p + size > c->limit) {
+        c = UTL_mk_chunk(a, size);
+        p = UTL_align(c->base);
+    }
+
+    c->base  = p + size;
+    a->used += size;
+
+    return p;
+}
+
+/**
+ * @brief Count bytes allocated or recycled for a tag, only if tracking.
+ *
+ * @param[in] a     Arena holding the object.
+ * @param[in] tag
+ * @param[in] size  Positive on alloc, negative on recycle.
+ */
+static void UTL_track(UTL_arena *a, UTL_tag tag, long size)
+{
+    UTL_stat *s = &UTL_cur()->stats[tag];
+
+    if (size > 0)
+        s->count++;
+
+    s->bytes     += size;
+    a->tags[tag] += size;
+    if (s->bytes > s->peak)
+        s->peak = s->bytes;
+}
+
+/**
+ * @brief Free all chunks of an arena, peak is kept.
+ *
+ * @param[in] a     Arena.
+ * @return int      Chunks freed.
+ */
+static int UTL_arena_release(UTL_arena *a)
+{
+    UTL_stat *stats = UTL_cur()->stats;
+    int t, cnt = 0;
+    UTL_chunk tmp;
+
+    while (a->chunks) {
+        cnt++;
+        tmp = a->chunks->next;
+        free(a->chunks);
+        a->chunks = tmp;
+    }
+
+    for (t = 0; t < UTL_tag_max; t++) {
+        stats[t].bytes -= a->tags[t];
+        a->tags[t]      = 0;
+    }
+
+    memset(a->blocks, 0, sizeof(a->blocks));
+    a->chunk_next = 0;
+    a->size       = 0;
+    a->used       = 0;
+
+    return cnt;
 }
 
 /****************************************************************************
@@ -43,55 +275,281 @@ static void UTL_add(void* p)
 
 void UTL_free(void)
 {
-    int cnt = 0;
-    UTL_slice tmp;
+    UTL_state *u = UTL_cur();
+    int r, cnt = 0;
+    size_t size = 0, used = 0;
 
-    while(slices) {
-        cnt++;
-        tmp = slices->next;
-        free(slices->ptr);
-        free(slices);
-        slices = tmp;
+    for (r = 0; r < UTL_region_max; r++) {
+        size += u->arenas[r].size;
+        used += u->arenas[r].used;
+        cnt  += UTL_arena_release(&u->arenas[r]);
     }
 
-    printf("%d slices have been free\n", cnt);
+    size += u->strings.size;
+    used += u->strings.used;
+    cnt  += UTL_arena_release(&u->strings);
+
+    fprintf(TIGER_out(),
+            "%zu bytes (%d chunks, %zu bytes used) have been free\n",
+            size, cnt, used);
+
+    u->depth = 0;
 }
 
 void *UTL_alloc(int size)
 {
-    void *p = malloc(size);
-    if (!p)
-        UTL_error(-1, "run out of memory");
+    return UTL_alloc_as(UTL_tag_other, size);
+}
+
+void *UTL_alloc_as(UTL_tag tag, int size)
+{
+    UTL_state *u = UTL_cur();
+
+    return UTL_alloc_in(u->stack[u->depth], tag, size);
+}
+
+void *UTL_alloc_in(UTL_region r, UTL_tag tag, int size)
+{
+    UTL_state *u = UTL_cur();
+    UTL_arena *a = &u->arenas[r];
+    void *p = UTL_arena_alloc(a, size);
+
+    if (__builtin_expect(u->tracking, 0))
+        UTL_track(a, tag, size);
+
+    return p;
+}
+
+void UTL_enter_region(UTL_region r)
+{
+    UTL_state *u = UTL_cur();
+
+    if (u->depth + 1 >= UTL_REGION_DEPTH)
+        UTL_error(UTL_NOPOS, "region stack overflow");
+
+    u->stack[++u->depth] = r;
+}
+
+void UTL_exit_region(void)
+{
+    UTL_state *u = UTL_cur();
+
+    if (u->depth <= 0)
+        UTL_error(UTL_NOPOS, "exit region without enter");
+
+    u->depth--;
+}
+
+void UTL_release_region(UTL_region r)
+{
+    UTL_state *u = UTL_cur();
+    int i;
+
+    for (i = 0; i <= u->depth; i++) {
+        if (u->stack[i] == r)
+            UTL_error(UTL_NOPOS, "release region(%s) in use", region_name[r]);
+    }
+
+    UTL_arena_release(&u->arenas[r]);
+}
+
+void UTL_report_regions(FILE *out)
+{
+    UTL_state *u = UTL_cur();
+    int r;
+
+    fprintf(out, "%-10s %12s %12s %12s\n", "region", "size", "used", "peak");
+    for (r = 0; r < UTL_region_max; r++) {
+        fprintf(out, "%-10s %12zu %12zu %12zu\n", region_name[r],
+                u->arenas[r].size, u->arenas[r].used, u->arenas[r].peak);
+    }
+    fprintf(out, "%-10s %12zu %12zu %12zu\n", "strings",
+            u->strings.size, u->strings.used, u->strings.peak);
+}
+
+void *UTL_pool_alloc(UTL_tag tag, int size)
+{
+    UTL_state *u = UTL_cur();
+    UTL_arena *a = &u->arenas[u->stack[u->depth]];
+    int c = (size - 1) / UTL_POOL_GRAIN;
+    UTL_block b;
+
+    if (size <= 0 || c >= UTL_POOL_CLASSES)
+        return UTL_alloc_as(tag, size);
+
+    b = a->blocks[c];
+    if (b) {
+        u->pools[c].hits++;
+        a->blocks[c] = b->next;
+        if (__builtin_expect(u->tracking, 0))
+            UTL_track(a, tag, (c + 1) * UTL_POOL_GRAIN);
+        return b;
+    }
+
+    u->pools[c].misses++;
+    return UTL_alloc_as(tag, (c + 1) * UTL_POOL_GRAIN);
+}
+
+void UTL_pool_free(UTL_tag tag, void *p, int size)
+{
+    UTL_state *u = UTL_cur();
+    UTL_arena *a = &u->arenas[u->stack[u->depth]];
+    int c = (size - 1) / UTL_POOL_GRAIN;
+    UTL_block b = p;
+
+    if (!p || size <= 0 || c >= UTL_POOL_CLASSES)
+        return;
+
+    if (__builtin_expect(u->tracking, 0))
+        UTL_track(a, tag, -(long)(c + 1) * UTL_POOL_GRAIN);
+
+    u->pools[c].frees++;
+    b->next      = a->blocks[c];
+    a->blocks[c] = b;
+}
+
+void UTL_report_pools(FILE *out)
+{
+    UTL_state *u = UTL_cur();
+    int c;
+
+    fprintf(out, "%-10s %12s %12s %12s\n", "pool", "hits", "misses", "frees");
+    for (c = 0; c < UTL_POOL_CLASSES; c++) {
+        fprintf(out, "%-10d %12zu %12zu %12zu\n", (c + 1) * UTL_POOL_GRAIN,
+                u->pools[c].hits, u->pools[c].misses, u->pools[c].frees);
+    }
+}
+
+void UTL_track_tags(bool enable)
+{
+    UTL_cur()->tracking = enable;
+}
+
+void UTL_report_tags(FILE *out, const char *phase)
+{
+    UTL_state *u = UTL_cur();
+    int t;
+
+    if (!u->tracking)
+        return;
+
+    fprintf(out, "%-10s %12s %12s %12s\n", phase, "count", "bytes", "peak");
+    for (t = 0; t < UTL_tag_max; t++) {
+        fprintf(out, "%-10s %12zu %12zu %12zu\n", tag_name[t],
+                u->stats[t].count, u->stats[t].bytes, u->stats[t].peak);
+    }
+}
+
+const char *UTL_strpool(const char *s, int len)
+{
+    UTL_state *u = UTL_cur();
+    UTL_chunk c = u->strings.chunks;
+    char *p;
+
+    if (!c || c->base + len + 1 > c->limit)
+        c = UTL_mk_chunk(&u->strings, len + 1);
+
+    p = c->base;
+    memcpy(p, s, len);
+    p[len] = '\0';
+
+    c->base          = p + len + 1;
+    u->strings.used += len + 1;
 
-    UTL_add(p);
     return p;
 }
 
 char *UTL_strdup(const char *s)
 {
-    char *p = strdup(s);
-    if (!p)
-        UTL_error(-1, "run out of memory");
+    size_t len = strlen(s) + 1;
+    char *p = UTL_alloc(len);
 
-    UTL_add(p);
+    memcpy(p, s, len);
     return p;
 }
 
+void UTL_set_locator(UTL_locator locate, void *ctx)
+{
+    UTL_state *u = UTL_cur();
+
+    u->locator     = locate;
+    u->locator_ctx = ctx;
+}
+
+/**
+ * @brief Print one error with its position to current output.
+ */
+static void UTL_report(int pos, const char *fmt, va_list ap)
+{
+    UTL_state *u = UTL_cur();
+    FILE *out = TIGER_out();
+    int line, col;
+
+    if (pos >= 0 && u->locator) {
+        u->locator(u->locator_ctx, pos, &line, &col);
+        fprintf(out, "Error at %d:%d:", line, col);
+    } else if (pos >= 0) {
+        fprintf(out, "Error at %d:", pos);
+    } else {
+        fprintf(out, "Error:");
+    }
+
+    vfprintf(out, fmt, ap);
+    fprintf(out, "\n");
+}
+
 void UTL_error(int pos, const char *fmt, ...)
 {
+    jmp_buf *bail = TIGER_bail();
     va_list ap;
 
-    if (pos > 0)
-        printf("Error at %d:", pos);
-    else
-        printf("Error:");
-
     va_start(ap, fmt);
-    vprintf(fmt, ap);
+    UTL_report(pos, fmt, ap);
     va_end(ap);
 
-    printf("\n");
+    // compilation is abandoned, owner of context frees it.
+    if (bail)
+        longjmp(*bail, 1);
 
     UTL_free();
     exit(1);
 }
+
+void UTL_diag(int pos, const char *fmt, ...)
+{
+    UTL_state *u = UTL_cur();
+    va_list ap;
+
+    if (u->quiet) {
+        u->quiet_errors++;
+        return;
+    }
+
+    va_start(ap, fmt);
+    UTL_report(pos, fmt, ap);
+    va_end(ap);
+
+    if (++u->errors >= UTL_DIAG_MAX)
+        UTL_error(UTL_NOPOS, "too many errors, %d reported", u->errors);
+}
+
+int UTL_errors(void)
+{
+    return UTL_cur()->errors;
+}
+
+int UTL_quiet(bool on)
+{
+    UTL_state *u = UTL_cur();
+    int n = u->quiet_errors;
+
+    u->quiet        = on;
+    u->quiet_errors = 0;
+
+    return n;
+}
+
+bool UTL_is_quiet(void)
+{
+    return UTL_cur()->quiet;
+}
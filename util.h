@@ -5,6 +5,8 @@
  ****************************************************************************/
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
 
 /****************************************************************************
  * Definitions
@@ -14,6 +16,39 @@
 
 typedef struct UTL_bool_list_ * UTL_bool_list;
 
+/**
+ * @brief Resolve byte offset to 1-based line and column, see UTL_error().
+ */
+typedef void (*UTL_locator)(void *ctx, int pos, int *line, int *col);
+
+/**
+ * @brief Memory regions.
+ *
+ * Each region owns an arena, everything allocated in it is released at
+ * once when the compiler phase using it is done. global is always at the
+ * bottom of the region stack and only released by UTL_free().
+ */
+typedef enum {
+    UTL_region_global,      /*< symbols, lives until UTL_free */
+    UTL_region_parse,       /*< lexer, parser and ast */
+    UTL_region_semant,      /*< environments and types */
+    UTL_region_max,
+} UTL_region;
+
+/**
+ * @brief Allocation categories, counted only when tracking is enabled.
+ */
+typedef enum {
+    UTL_tag_other,
+    UTL_tag_ast,
+    UTL_tag_symbol,
+    UTL_tag_bind,
+    UTL_tag_type,
+    UTL_tag_frame,
+    UTL_tag_temp,
+    UTL_tag_max,
+} UTL_tag;
+
 struct UTL_bool_list_ { bool head; UTL_bool_list tail; };
 
 /****************************************************************************
@@ -21,11 +56,76 @@ struct UTL_bool_list_ { bool head; UTL_bool_list tail; };
  ****************************************************************************/
 
 /**
+ * bump-allocate in current region, aligned to 16 bytes, freed when the
+ * region is released or by UTL_free.
  * exit if running out of memory.
  * @param[in] size
  */
 void *UTL_alloc(int size);
 
+/**
+ * alloc in current region, counted as tag.
+ * @param[in] tag
+ * @param[in] size
+ */
+void *UTL_alloc_as(UTL_tag tag, int size);
+
+/**
+ * alloc in given region instead of current one, counted as tag.
+ * @param[in] region
+ * @param[in] tag
+ * @param[in] size
+ */
+void *UTL_alloc_in(UTL_region region, UTL_tag tag, int size);
+
+/**
+ * @brief Alloc small fixed-size object from size class free list.
+ *
+ * Sizes up to 64 bytes are rounded to a 16 bytes class and recycled by
+ * UTL_pool_free(), larger ones fall back to UTL_alloc_as().
+ *
+ * @param[in] tag
+ * @param[in] size
+ */
+void *UTL_pool_alloc(UTL_tag tag, int size);
+
+/**
+ * @brief Give object back to its size class free list.
+ *
+ * Object must come from UTL_pool_alloc() in current region.
+ *
+ * @param[in] tag   Tag passed to UTL_pool_alloc().
+ * @param[in] p
+ * @param[in] size  Size passed to UTL_pool_alloc().
+ */
+void UTL_pool_free(UTL_tag tag, void *p, int size);
+
+/**
+ * @brief Show hit, miss and free counters of every size class.
+ *
+ * @param[in] out
+ */
+void UTL_report_pools(FILE *out);
+
+/**
+ * @brief Enable or disable counting allocations by tag.
+ *
+ * Disabled by default, then allocation pays only one branch.
+ *
+ * @param[in] enable
+ */
+void UTL_track_tags(bool enable);
+
+/**
+ * @brief Show count, bytes held and peak bytes of every tag.
+ *
+ * Nothing is shown if tracking is disabled.
+ *
+ * @param[in] out
+ * @param[in] phase     Title of the table.
+ */
+void UTL_report_tags(FILE *out, const char *phase);
+
 /**
  * exit if running out of memory.
  * @param[in] s
@@ -33,18 +133,103 @@ void *UTL_alloc(int size);
 char *UTL_strdup(const char *s);
 
 /**
- * free everything.
+ * @brief Copy bytes to string pool.
+ *
+ * Strings are stored back-to-back (no alignment) in large blocks, live
+ * until UTL_free(). s need not be null-terminated.
+ *
+ * @param[in] s     Bytes, e.g. a slice of lexer buffer.
+ * @param[in] len   Bytes to copy.
+ * @return const char*  Null-terminated copy.
+ */
+const char *UTL_strpool(const char *s, int len);
+
+/**
+ * free everything, release all arena chunks and report freed bytes.
  */
 void UTL_free(void);
 
+/**
+ * @brief Enter region, following allocations go to it.
+ *
+ * @param[in] region
+ */
+void UTL_enter_region(UTL_region region);
+
+/**
+ * @brief Exit current region, back to the previous entered one.
+ */
+void UTL_exit_region(void);
+
+/**
+ * @brief Free everything allocated in region.
+ *
+ * Region must not be entered, its high-water mark is kept.
+ *
+ * @param[in] region
+ */
+void UTL_release_region(UTL_region region);
+
+/**
+ * @brief Show size, used bytes and high-water mark of every region.
+ *
+ * @param[in] out
+ */
+void UTL_report_regions(FILE *out);
+
+/**
+ * @brief Set how UTL_error() shows positions.
+ *
+ * Without locator, positions are shown as byte offsets.
+ *
+ * @param[in] locate
+ * @param[in] ctx       passed to locate.
+ */
+void UTL_set_locator(UTL_locator locate, void *ctx);
+
 /**
  * free everything, print error and exit.
- * @param[in] pos   error position.
+ * @param[in] pos   error position, byte offset or UTL_NOPOS.
  * @param[in] msg   formatted error message.
  * @param[in] ...   formatted args.
  */
 void UTL_error(int pos, const char *fmt, ...);
 
+/**
+ * @brief Print error and go on, caller recovers and checks what follows.
+ *
+ * Printed like UTL_error(). The run gives up once too many are reported.
+ *
+ * @param[in] pos   error position, byte offset or UTL_NOPOS.
+ * @param[in] fmt   formatted error message.
+ * @param[in] ...   formatted args.
+ */
+void UTL_diag(int pos, const char *fmt, ...);
+
+/**
+ * @brief Number of errors reported by UTL_diag() in current context.
+ *
+ * @return int
+ */
+int UTL_errors(void);
+
+/**
+ * @brief Count errors quietly, apart from UTL_errors().
+ *
+ * While quiet, UTL_diag() reports nothing and the run never gives up.
+ *
+ * @param[in] on
+ * @return int  Errors counted quietly since last call.
+ */
+int UTL_quiet(bool on);
+
+/**
+ * @brief Whether UTL_diag() is quiet, details of errors are left out too.
+ *
+ * @return bool
+ */
+bool UTL_is_quiet(void);
+
 /**
  * @brief Bool list constructor.
  * 
@@ -0,0 +1,303 @@
+/****************************************************************************
+ * Includes
+ ****************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "util.h"
+#include "visit.h"
+
+/****************************************************************************
+ * Definitions
+ ****************************************************************************/
+
+#define VIS_STACK_SIZE  64  /*< initial frames */
+
+struct VIS_walk_
+{
+    VIS_step    step;
+    void *      ctx;
+    int         stride;     /*< bytes of frame and locals */
+    char *      stack;      /*< in region of walk, kept for next run */
+    int         n, cap;     /*< frames */
+    bool        pushed;     /*< current step has pushed a child */
+};
+
+/**
+ * @brief Pre- and post-order callbacks, context of VIS_order().
+ */
+typedef struct VIS_orderer_
+{
+    VIS_visit   pre, post;
+    void *      ctx;
+} VIS_orderer;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static inline VIS_frame *VIS_at(VIS_walk w, int i)
+{
+    return (VIS_frame *)(w->stack + (size_t)i * w->stride);
+}
+
+/**
+ * @brief Child k of node in source order.
+ *
+ * @param[in] all       Count absent children too, as NULL.
+ * @param[out] class    Class of child.
+ * @param[out] child    Child, a NULL list stands for the empty one.
+ * @return bool         false if node has no child k.
+ */
+static bool VIS_child(VIS_class c, void *node, int k, bool all,
+                      VIS_class *class, void **child)
+{
+    VIS_class cs[3];
+    void *    ns[3];
+    int       n = 0;
+
+#define VIS_ADD(cl, x) \
+    ({ if ((x) || all) { cs[n] = (cl); ns[n++] = (x); } })
+#define VIS_LIST(cl, x) \
+    ({ cs[n] = (cl); ns[n++] = (x); })
+#define VIS_ITEM(cl, l) \
+    ({ if (k >= AST_LEN(l)) return false; \
+       *class = (cl); *child = (l)->items[k]; return true; })
+
+    switch (c) {
+        case VIS_exp: {
+            AST_exp e = node;
+
+            switch (e->kind) {
+                case AST_kind_exp_var:
+                    VIS_ADD(VIS_var, e->u.var);
+                    break;
+                case AST_kind_exp_call:
+                    VIS_LIST(VIS_exp_list, e->u.call.args);
+                    break;
+                case AST_kind_exp_op:
+                    VIS_ADD(VIS_exp, e->u.op.left);
+                    VIS_ADD(VIS_exp, e->u.op.right);
+                    break;
+                case AST_kind_exp_array:
+                    VIS_ADD(VIS_exp, e->u.array.size);
+                    VIS_ADD(VIS_exp, e->u.array.init);
+                    break;
+                case AST_kind_exp_record:
+                    VIS_LIST(VIS_arg_list, e->u.record.args);
+                    break;
+                case AST_kind_exp_seq:
+                    VIS_LIST(VIS_exp_list, e->u.seq);
+                    break;
+                case AST_kind_exp_assign:
+                    VIS_ADD(VIS_var, e->u.assign.var);
+                    VIS_ADD(VIS_exp, e->u.assign.exp);
+                    break;
+                case AST_kind_exp_if:
+                    VIS_ADD(VIS_exp, e->u.if_.cond);
+                    VIS_ADD(VIS_exp, e->u.if_.then);
+                    VIS_ADD(VIS_exp, e->u.if_.else_);
+                    break;
+                case AST_kind_exp_while:
+                    VIS_ADD(VIS_exp, e->u.while_.cond);
+                    VIS_ADD(VIS_exp, e->u.while_.body);
+                    break;
+                case AST_kind_exp_for:
+                    VIS_ADD(VIS_exp, e->u.for_.lo);
+                    VIS_ADD(VIS_exp, e->u.for_.hi);
+                    VIS_ADD(VIS_exp, e->u.for_.body);
+                    break;
+                case AST_kind_exp_let:
+                    VIS_LIST(VIS_dec_list, e->u.let.decs);
+                    VIS_LIST(VIS_exp_list, e->u.let.body);
+                    break;
+                default:
+                    break;
+            }
+            break;
+        }
+
+        case VIS_dec: {
+            AST_dec d = node;
+
+            switch (d->kind) {
+                case AST_kind_dec_var:
+                    VIS_ADD(VIS_exp, d->u.var.init);
+                    break;
+                case AST_kind_dec_type:
+                    VIS_ADD(VIS_type, d->u.type.type);
+                    break;
+                case AST_kind_dec_func:
+                    VIS_LIST(VIS_para_list, d->u.func.paras);
+                    VIS_ADD(VIS_exp, d->u.func.body);
+                    break;
+            }
+            break;
+        }
+
+        case VIS_var: {
+            AST_var v = node;
+
+            switch (v->kind) {
+                case AST_kind_var_base:
+                    VIS_ADD(VIS_var, v->u.base.suffix);
+                    break;
+                case AST_kind_var_index:
+                    VIS_ADD(VIS_exp, v->u.index.exp);
+                    VIS_ADD(VIS_var, v->u.index.suffix);
+                    break;
+                case AST_kind_var_field:
+                    VIS_ADD(VIS_var, v->u.field.suffix);
+                    break;
+            }
+            break;
+        }
+
+        case VIS_type: {
+            AST_type t = node;
+
+            if (t->kind == AST_kind_type_record)
+                VIS_LIST(VIS_para_list, t->u.record);
+            break;
+        }
+
+        case VIS_para:
+            break;
+
+        case VIS_arg:
+            VIS_ADD(VIS_exp, ((AST_arg)node)->exp);
+            break;
+
+        case VIS_exp_list:  VIS_ITEM(VIS_exp,  (AST_exp_list)node);
+        case VIS_dec_list:  VIS_ITEM(VIS_dec,  (AST_dec_list)node);
+        case VIS_para_list: VIS_ITEM(VIS_para, (AST_para_list)node);
+        case VIS_arg_list:  VIS_ITEM(VIS_arg,  (AST_arg_list)node);
+    }
+
+#undef VIS_ADD
+#undef VIS_LIST
+#undef VIS_ITEM
+
+    if (k >= n)
+        return false;
+
+    *class = cs[k];
+    *child = ns[k];
+    return true;
+}
+
+static void VIS_order_step(VIS_walk w, VIS_frame *f, void *ctx)
+{
+    VIS_orderer *o = ctx;
+    int depth = w->n - 1;
+
+    if (f->step == 0 && o->pre)
+        o->pre(f->class, f->node, depth, o->ctx);
+
+    // f is stale once a child is pushed.
+    if (!VIS_next(w, f) && o->post)
+        o->post(f->class, f->node, depth, o->ctx);
+}
+
+/****************************************************************************
+ * Public: step walk
+ ****************************************************************************/
+
+VIS_walk VIS_mk_walk(VIS_step step, int local, void *ctx)
+{
+    VIS_walk w = UTL_alloc_as(UTL_tag_other, sizeof(*w));
+
+    w->step   = step;
+    w->ctx    = ctx;
+    w->stride = (sizeof(VIS_frame) + local + 7) & ~7;
+    w->stack  = NULL;
+    w->n      = 0;
+    w->cap    = 0;
+    w->pushed = false;
+
+    return w;
+}
+
+void VIS_run(VIS_walk w, VIS_class class, void *node)
+{
+    VIS_frame *f;
+
+    w->pushed = false;
+    VIS_push(w, class, node);
+    while (w->n > 0) {
+        f = VIS_at(w, w->n - 1);
+        w->pushed = false;
+        w->step(w, f, w->ctx);
+
+        // done, frame is kept until next push for VIS_done().
+        if (!w->pushed && --w->n > 0)
+            VIS_at(w, w->n - 1)->step++;
+    }
+}
+
+void *VIS_push(VIS_walk w, VIS_class class, void *node)
+{
+    VIS_frame *f;
+
+    if (w->pushed)
+        UTL_error(UTL_NOPOS, "visit, two children pushed in one step");
+
+    // a bail leaves the walk midway, stack goes with the region. blocks
+    // outgrown stay there until it is released, less than the last one.
+    if (w->n == w->cap) {
+        char *stack;
+
+        w->cap = w->cap ? w->cap * 2 : VIS_STACK_SIZE;
+        stack  = UTL_alloc_as(UTL_tag_other, w->cap * w->stride);
+        if (w->n)
+            memcpy(stack, w->stack, (size_t)w->n * w->stride);
+        w->stack = stack;
+    }
+
+    f = VIS_at(w, w->n++);
+    memset(f, 0, w->stride);
+    f->class  = class;
+    f->node   = node;
+    w->pushed = true;
+
+    return VIS_local(f);
+}
+
+bool VIS_next(VIS_walk w, VIS_frame *f)
+{
+    VIS_class class;
+    void *child;
+
+    if (!VIS_child(f->class, f->node, f->step, false, &class, &child))
+        return false;
+
+    VIS_push(w, class, child);
+    return true;
+}
+
+bool VIS_slot(VIS_class c, void *node, int k, VIS_class *class, void **child)
+{
+    return VIS_child(c, node, k, true, class, child);
+}
+
+void *VIS_done(VIS_walk w)
+{
+    return VIS_local(VIS_at(w, w->n));
+}
+
+VIS_frame *VIS_up(VIS_walk w)
+{
+    return w->n > 1 ? VIS_at(w, w->n - 2) : NULL;
+}
+
+/****************************************************************************
+ * Public: order walk
+ ****************************************************************************/
+
+void VIS_order(VIS_class class, void *node, VIS_visit pre, VIS_visit post,
+               void *ctx)
+{
+    VIS_orderer o = { pre, post, ctx };
+
+    VIS_run(VIS_mk_walk(VIS_order_step, 0, &o), class, node);
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+/****************************************************************************
+ * Includes
+ ****************************************************************************/
+
+#include <stdbool.h>
+#include "ast.h"
+
+/****************************************************************************
+ * Definitions
+ ****************************************************************************/
+
+/**
+ * @brief What a frame's node is.
+ *
+ * Lists are nodes of their own so every element has a place in the walk,
+ * a NULL list is an empty one and is still visited.
+ */
+typedef enum {
+    VIS_exp,        /*< AST_exp */
+    VIS_dec,        /*< AST_dec */
+    VIS_var,        /*< AST_var */
+    VIS_type,       /*< AST_type */
+    VIS_para,       /*< AST_para, no children */
+    VIS_arg,        /*< AST_arg */
+    VIS_exp_list,   /*< AST_exp_list */
+    VIS_dec_list,   /*< AST_dec_list */
+    VIS_para_list,  /*< AST_para_list */
+    VIS_arg_list,   /*< AST_arg_list */
+} VIS_class;
+
+/**
+ * @brief Node being visited, followed by locals of the pass.
+ *
+ * Frames live on a stack in current region, nesting is only bounded by
+ * memory. They move when the stack grows: a frame pointer is good until
+ * the next VIS_push().
+ */
+typedef struct VIS_frame_
+{
+    VIS_class   class;
+    int         step;   /*< children done, 0 when node is entered */
+    void *      node;
+} VIS_frame;
+
+typedef struct VIS_walk_ *VIS_walk;
+
+/**
+ * @brief Step a node, called on entering it and after each child is done.
+ *
+ * A step pushes at most one child, the node is done once a step pushes
+ * none. A child is visited whole before its parent is stepped again, so a
+ * pass checks and prints in the order a recursive one would.
+ */
+typedef void (*VIS_step)(VIS_walk w, VIS_frame *f, void *ctx);
+
+/**
+ * @brief Called before or after all children of a node, see VIS_order().
+ */
+typedef void (*VIS_visit)(VIS_class class, void *node, int depth, void *ctx);
+
+/****************************************************************************
+ * Public: step walk
+ ****************************************************************************/
+
+/**
+ * @brief Walk constructor, in current region.
+ *
+ * @param[in] step
+ * @param[in] local     Bytes of pass locals per frame, zeroed on push.
+ * @param[in] ctx       Given to every step.
+ * @return VIS_walk
+ */
+VIS_walk VIS_mk_walk(VIS_step step, int local, void *ctx);
+
+/**
+ * @brief Walk tree from node until its frame is done.
+ *
+ * @param[in] w
+ * @param[in] class
+ * @param[in] node
+ */
+void VIS_run(VIS_walk w, VIS_class class, void *node);
+
+/**
+ * @brief Visit child next, from a step.
+ *
+ * @param[in] w
+ * @param[in] class
+ * @param[in] node
+ * @return void*    Child locals, zeroed, for the parent to fill in.
+ */
+void *VIS_push(VIS_walk w, VIS_class class, void *node);
+
+/**
+ * @brief Push child number f->step of node in source order, from a step.
+ *
+ * Absent children (NULL else, suffix or init) are skipped, lists are not.
+ *
+ * @param[in] w
+ * @param[in] f
+ * @return bool     false if node has no child left.
+ */
+bool VIS_next(VIS_walk w, VIS_frame *f);
+
+/**
+ * @brief Child slot k of node in source order, absent children included.
+ *
+ * For passes that place each child by its slot, VIS_next() skips absent
+ * ones (NULL else, suffix or init) and counts only those present.
+ *
+ * @param[in] c         Class of node.
+ * @param[in] node
+ * @param[in] k
+ * @param[out] class    Class of child.
+ * @param[out] child    Child, NULL if absent.
+ * @return bool         false if node has no slot k.
+ */
+bool VIS_slot(VIS_class c, void *node, int k, VIS_class *class, void **child);
+
+/**
+ * @brief Locals of child just done, valid in the step after it.
+ *
+ * @param[in] w
+ * @return void*
+ */
+void *VIS_done(VIS_walk w);
+
+/**
+ * @brief Frame of parent of node being stepped.
+ *
+ * @param[in] w
+ * @return VIS_frame*   NULL at the node walk started from.
+ */
+VIS_frame *VIS_up(VIS_walk w);
+
+/**
+ * @brief Locals of frame.
+ */
+static inline void *VIS_local(VIS_frame *f)
+{
+    return f + 1;
+}
+
+/****************************************************************************
+ * Public: order walk
+ ****************************************************************************/
+
+/**
+ * @brief Visit every node in source order.
+ *
+ * @param[in] class
+ * @param[in] node
+ * @param[in] pre   Called on entering node, NULL for none.
+ * @param[in] post  Called after its children, NULL for none.
+ * @param[in] ctx
+ */
+void VIS_order(VIS_class class, void *node, VIS_visit pre, VIS_visit post,
+               void *ctx);